@@ -0,0 +1,27 @@
+#version 450
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(location = 0) uniform ivec2 tileCount; // 32x32 tiles covering the image
+layout(binding = 8, std430) readonly buffer _occupancy_block {
+	uint occupied[];
+};
+layout(binding = 9, std430) buffer _active_tiles_block {
+	uint activeGroups[3]; // indirect dispatch arguments of postprocess.glsl, must be (0, 1, 1) before
+	uint activeTiles[];
+};
+
+// occupied tiles and their neighbors, whose trail diffuses into them
+void main() {
+	ivec2 tile = ivec2(gl_GlobalInvocationID.xy);
+	if(tile.x >= tileCount.x || tile.y >= tileCount.y)
+		return;
+	ivec2 lower = max(tile - 1, ivec2(0));
+	ivec2 upper = min(tile + 1, tileCount - 1);
+	for(int y = lower.y; y <= upper.y; ++y)
+		for(int x = lower.x; x <= upper.x; ++x)
+			if(occupied[y * tileCount.x + x] != 0) {
+				activeTiles[atomicAdd(activeGroups[0], 1)] = tile.y * tileCount.x + tile.x;
+				return;
+			}
+}
@@ -0,0 +1,52 @@
+#version 450
+
+layout(local_size_x = 256) in;
+
+struct Agent {
+	vec2 pos;
+	float angleRadians;
+	uint species; // ∈ [0, 3]
+	float age; // seconds
+	float energy; // ∈ [0, 1]
+};
+
+layout(binding = 0, std430) readonly buffer _block_name {
+	Agent agents[];
+};
+layout(binding = 2, std430) readonly buffer _population_block {
+	uint liveAgents;
+};
+layout(binding = 1, std430) buffer _statistics_block {
+	uint histograms[4 * 32]; // per species, texels by trail density
+	uint covered; // texels with any trail
+	uint clamped; // agents clamped at borders
+	int headingX, headingY; // Σ heading vectors, fixed point (1/256)
+	uint speed; // Σ pixels/second actually moved, from slime.glsl
+	uint agentCount;
+	uint movedAgents;
+};
+
+shared vec2 partial[gl_WorkGroupSize.x]; // heading
+
+void main() {
+	uint index = gl_GlobalInvocationID.x;
+	uint local = gl_LocalInvocationIndex;
+	vec2 value = vec2(0);
+	if(index < liveAgents) {
+		Agent agent = agents[index];
+		value = vec2(cos(agent.angleRadians), sin(agent.angleRadians));
+	}
+	partial[local] = value;
+	barrier();
+	for(uint stride = gl_WorkGroupSize.x / 2; stride > 0; stride /= 2) {
+		if(local < stride)
+			partial[local] += partial[local + stride];
+		barrier();
+	}
+	if(local != 0)
+		return;
+	uint first = gl_WorkGroupID.x * gl_WorkGroupSize.x;
+	atomicAdd(headingX, int(round(partial[0].x * 256)));
+	atomicAdd(headingY, int(round(partial[0].y * 256)));
+	atomicAdd(agentCount, min(liveAgents - first, gl_WorkGroupSize.x));
+}
@@ -0,0 +1,46 @@
+#version 450
+
+layout(local_size_x = 64) in;
+
+struct Agent {
+	vec2 pos;
+	float angleRadians;
+	uint species; // ∈ [0, 3]
+	float age; // seconds
+	float energy; // ∈ [0, 1]
+};
+
+layout(location = 0) uniform uint capacity;
+layout(binding = 0, std430) readonly buffer _block_name {
+	Agent agents[];
+};
+layout(binding = 2, std430) readonly buffer _population_block {
+	uint liveAgents;
+};
+layout(binding = 3, std430) readonly buffer _count_block {
+	uint counts[];
+};
+layout(binding = 4, std430) readonly buffer _children_block {
+	Agent children[];
+};
+layout(binding = 5, std430) readonly buffer _offset_block {
+	uint offsets[];
+};
+layout(binding = 6, std430) readonly buffer _block_sum_block {
+	uint blockSums[];
+};
+layout(binding = 7, std430) writeonly buffer _compacted_block {
+	Agent compacted[];
+};
+
+void main() {
+	uint index = gl_GlobalInvocationID.x;
+	if(index >= liveAgents)
+		return;
+	uint count = counts[index];
+	uint destination = offsets[index] + blockSums[index / 1024];
+	if(count >= 1 && destination < capacity)
+		compacted[destination] = agents[index];
+	if(count == 2 && destination + 1 < capacity)
+		compacted[destination + 1] = children[index];
+}
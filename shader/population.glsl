@@ -0,0 +1,20 @@
+#version 450
+
+layout(local_size_x = 1) in;
+
+layout(location = 0) uniform uint capacity;
+layout(binding = 2, std430) buffer _population_block {
+	uint liveAgents;
+	uint nextAgents;
+	uint simulateGroups[3]; // indirect dispatch arguments for workgroups of 64 agents
+	uint scanGroups[3]; // 1024
+	uint statisticsGroups[3]; // 256
+};
+
+void main() {
+	uint live = min(nextAgents, capacity);
+	liveAgents = live;
+	simulateGroups = uint[3]((live + 63) / 64, 1, 1);
+	scanGroups = uint[3]((live + 1023) / 1024, 1, 1);
+	statisticsGroups = uint[3]((live + 255) / 256, 1, 1);
+}
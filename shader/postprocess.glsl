@@ -1,4 +1,4 @@
-#version 460
+#version 450
 
 layout(local_size_x = 32, local_size_y = 32) in;
 
@@ -6,8 +6,20 @@ layout(location = 0) uniform float deltaTime; // must be set
 layout(location = 1) uniform float decayRate = 0.1; // must be non-negative
 layout(location = 2) uniform float diffuseRate = 3; // must be non-negative
 layout(location = 3) uniform vec3 species_colors[4];
+layout(location = 7) uniform ivec2 offset = ivec2(0); // first processed texel
+layout(location = 8) uniform ivec2 extent = ivec2(0); // processed texels, (0, 0) → size of image
+layout(location = 9) uniform bool sparse = false; // one workgroup per active tile, occupancy & active tiles must be bound
 layout(binding = 0, rgba32f) uniform image2D image;
 layout(binding = 1, rgba32f) uniform image2D coloredImage;
+layout(binding = 8, std430) writeonly buffer _occupancy_block {
+	uint occupied[]; // per 32x32 tile of image, row-major
+};
+layout(binding = 9, std430) readonly buffer _active_tiles_block {
+	uint _activeGroups[3];
+	uint activeTiles[];
+};
+
+shared bool nonEmpty;
 
 vec4 speciesMask(uint species) {
 	switch(species) {
@@ -18,11 +30,8 @@ vec4 speciesMask(uint species) {
 	}
 }
 
-void main() {
-	ivec2 size = imageSize(image);
-	ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
-	if(pos.x >= size.x || pos.y >= size.y)
-		return;
+// returns the decayed trail
+vec4 process(ivec2 pos, ivec2 size) {
 	vec4 original = imageLoad(image, pos);
 	vec4 sum = vec4(0);
 	for(int x = -1; x <= 1; ++x)
@@ -36,4 +45,27 @@ void main() {
 	for(uint species = 0; species < 4; ++species)
 		colored += dot(speciesMask(species), decayed) * species_colors[species];
 	imageStore(coloredImage, pos, vec4(colored, 1));
+	return decayed;
+}
+
+void main() {
+	ivec2 size = imageSize(image);
+	if(!sparse) {
+		ivec2 processed = extent == ivec2(0) ? size : extent;
+		if(gl_GlobalInvocationID.x < processed.x && gl_GlobalInvocationID.y < processed.y)
+			process(ivec2(gl_GlobalInvocationID.xy) + offset, size);
+		return;
+	}
+	// tiles that stay inactive keep their last, empty, colored texels
+	uint tile = activeTiles[gl_WorkGroupID.x];
+	int tilesX = (size.x + 31) / 32;
+	ivec2 pos = ivec2(tile % tilesX, tile / tilesX) * 32 + ivec2(gl_LocalInvocationID.xy);
+	if(gl_LocalInvocationIndex == 0)
+		nonEmpty = false;
+	barrier();
+	if(pos.x < size.x && pos.y < size.y && any(greaterThan(process(pos, size), vec4(0))))
+		nonEmpty = true;
+	barrier();
+	if(gl_LocalInvocationIndex == 0)
+		occupied[tile] = uint(nonEmpty);
 }
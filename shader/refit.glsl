@@ -0,0 +1,76 @@
+#version 450
+
+layout(local_size_x = 64) in;
+
+struct Sphere {
+	vec4 data; // (center.xyz, radius)
+};
+
+struct Node {
+	vec3 lo;
+	uint left; // leaf: index of sphere
+	vec3 hi;
+	uint right;
+	uint parent;
+	float cost; // summed surface area of internal nodes in subtree
+};
+
+layout(location = 0) uniform float deltaTime; // 0 → only refit
+layout(location = 1) uniform uint numSpheres;
+layout(location = 2) uniform vec3 boxMin; // spheres bounce inside box
+layout(location = 3) uniform vec3 boxMax;
+layout(binding = 0, std430) buffer _sphere_block {
+	Sphere spheres[];
+};
+layout(binding = 1, std430) coherent buffer _node_block {
+	Node nodes[]; // internal nodes: [0, numSpheres - 1), leaves: [numSpheres - 1, 2 * numSpheres - 1)
+};
+layout(binding = 2, std430) buffer _velocity_block {
+	vec4 velocities[]; // (velocity.xyz, unused)
+};
+layout(binding = 3, std430) buffer _counter_block {
+	uint counters[]; // per internal node, must be zeroed
+};
+
+float area(vec3 lo, vec3 hi) {
+	vec3 d = hi - lo;
+	return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+void main() {
+	uint leaf = gl_GlobalInvocationID.x;
+	if(leaf >= numSpheres)
+		return;
+	uint index = numSpheres - 1 + leaf;
+	uint sphere = nodes[index].left;
+	vec4 s = spheres[sphere].data;
+	if(deltaTime != 0) {
+		vec3 velocity = velocities[sphere].xyz;
+		vec3 center = s.xyz + velocity * deltaTime;
+		// reflect position & direction off the walls of the box
+		vec3 below = max(boxMin - center, 0);
+		vec3 above = max(center - boxMax, 0);
+		center += 2 * below - 2 * above;
+		velocity *= 1 - 2 * sign(below + above);
+		s.xyz = clamp(center, boxMin, boxMax);
+		spheres[sphere].data = s;
+		velocities[sphere].xyz = velocity;
+	}
+	nodes[index].lo = s.xyz - s.w;
+	nodes[index].hi = s.xyz + s.w;
+	nodes[index].cost = 0;
+	// the second child to arrive at a parent refits it, the first one stops
+	while(index != 0) {
+		index = nodes[index].parent;
+		memoryBarrierBuffer();
+		if(atomicAdd(counters[index], 1) == 0)
+			return;
+		Node left = nodes[nodes[index].left];
+		Node right = nodes[nodes[index].right];
+		vec3 lo = min(left.lo, right.lo);
+		vec3 hi = max(left.hi, right.hi);
+		nodes[index].lo = lo;
+		nodes[index].hi = hi;
+		nodes[index].cost = area(lo, hi) + left.cost + right.cost;
+	}
+}
@@ -1,4 +1,4 @@
-#version 460
+#version 450
 
 layout(local_size_x = 8, local_size_y = 8) in;
 
@@ -6,11 +6,27 @@ struct Sphere {
 	vec4 data; // (center.xyz, radius)
 };
 
+struct Node {
+	vec3 lo;
+	uint left; // leaf: index of sphere
+	vec3 hi;
+	uint right;
+	uint parent;
+	float cost;
+};
+
+#define INFINITY 1e30
 layout(location = 0) uniform float fov = 1;
+layout(location = 1) uniform uint numSpheres = 1;
+layout(location = 2) uniform ivec2 offset = ivec2(0); // position of image in whole picture
+layout(location = 3) uniform ivec2 pictureSize = ivec2(0); // (0, 0) → size of image
 layout(binding = 0, rgba32f) uniform image2D image;
-layout(binding = 0, std430) buffer _block_name {
+layout(binding = 0, std430) readonly buffer _sphere_block {
 	Sphere spheres[];
 };
+layout(binding = 1, std430) readonly buffer _node_block {
+	Node nodes[]; // internal nodes: [0, numSpheres - 1), leaves: [numSpheres - 1, 2 * numSpheres - 1)
+};
 
 // Circle defined by c & r: p: length(p-c)²=r²
 // Ray defined by o & d: p: p=o+l*d
@@ -35,22 +51,59 @@ float distanceToSphere(vec3 o, vec3 d, vec3 c, float r) {
 	return -numerator/2;
 }
 
+bool hitsBox(vec3 o, vec3 invD, vec3 lo, vec3 hi, float closest) {
+	vec3 t0 = (lo - o) * invD;
+	vec3 t1 = (hi - o) * invD;
+	vec3 tMin = min(t0, t1);
+	vec3 tMax = max(t0, t1);
+	float tNear = max(max(tMin.x, tMin.y), tMin.z);
+	float tFar = min(min(tMax.x, tMax.y), tMax.z);
+	return tNear <= tFar && tFar >= 0 && tNear < closest;
+}
+
+// returns distance to closest sphere or -1
+float trace(vec3 o, vec3 d, out vec3 center) {
+	vec3 invD = 1 / d;
+	float closest = INFINITY;
+	uint firstLeaf = numSpheres - 1;
+	uint stack[32];
+	uint top = 0;
+	stack[top++] = 0;
+	while(top > 0) {
+		uint index = stack[--top];
+		Node node = nodes[index];
+		if(!hitsBox(o, invD, node.lo, node.hi, closest))
+			continue;
+		if(index >= firstLeaf) {
+			vec4 s = spheres[node.left].data;
+			float t = distanceToSphere(o, d, s.xyz, s.w);
+			if(t != -1 && t < closest) {
+				closest = t;
+				center = s.xyz;
+			}
+		} else if(top + 2 <= stack.length()) {
+			stack[top++] = node.left;
+			stack[top++] = node.right;
+		}
+	}
+	return closest == INFINITY ? -1 : closest;
+}
+
 void main() {
 	ivec2 size = imageSize(image);
 	if(gl_GlobalInvocationID.x >= size.x || gl_GlobalInvocationID.y >= size.y)
 		return;
 	ivec2 iC = ivec2(gl_GlobalInvocationID.xy);
-	vec2 uv = iC / vec2(size - 1);
+	ivec2 picture = pictureSize == ivec2(0) ? size : pictureSize;
+	vec2 uv = (iC + offset) / vec2(picture - 1);
 
 	vec3 origin = vec3(0);
 	float maxX = tan(fov / 2);
-	vec2 max = {maxX, maxX * size.y / size.x};
+	vec2 max = {maxX, maxX * picture.y / picture.x};
 	vec3 dir = normalize(vec3((2 * uv - 1) * max, -1));
-	vec4 s = spheres[0].data;
-	vec3 c = s.xyz;
-	float r = s.w;
+	vec3 c;
 
-	float d = distanceToSphere(origin, dir, c, r);
+	float d = trace(origin, dir, c);
 	vec3 col = d == -1 ? vec3(0) : abs(normalize(origin + d * dir - c));
 	imageStore(image, iC, vec4(col, 1));
 }
@@ -0,0 +1,55 @@
+#version 450
+
+layout(local_size_x = 1024) in;
+
+layout(location = 0) uniform uint level; // 0: counts of agents, 1: sums of level 0 blocks
+layout(binding = 2, std430) buffer _population_block {
+	uint liveAgents;
+	uint nextAgents; // set by level 1
+};
+layout(binding = 3, std430) readonly buffer _count_block {
+	uint counts[];
+};
+layout(binding = 5, std430) writeonly buffer _offset_block {
+	uint offsets[]; // exclusive prefix sum of counts within block
+};
+layout(binding = 6, std430) buffer _block_sum_block {
+	uint blockSums[]; // level 0: sum of block, level 1: exclusive prefix sum
+};
+
+shared uint values[gl_WorkGroupSize.x];
+
+// Hillis & Steele, returns exclusive prefix sum within workgroup
+uint scan(uint value) {
+	uint local = gl_LocalInvocationIndex;
+	values[local] = value;
+	barrier();
+	for(uint offset = 1; offset < gl_WorkGroupSize.x; offset *= 2) {
+		uint addend = local >= offset ? values[local - offset] : 0;
+		barrier();
+		values[local] += addend;
+		barrier();
+	}
+	return values[local] - value;
+}
+
+void main() {
+	uint index = gl_GlobalInvocationID.x;
+	uint last = gl_WorkGroupSize.x - 1;
+	if(level == 0) {
+		uint count = index < liveAgents ? counts[index] : 0;
+		uint offset = scan(count);
+		if(index < liveAgents)
+			offsets[index] = offset;
+		if(gl_LocalInvocationIndex == last)
+			blockSums[gl_WorkGroupID.x] = offset + count;
+	} else {
+		uint numBlocks = (liveAgents + last) / gl_WorkGroupSize.x;
+		uint sum = index < numBlocks ? blockSums[index] : 0;
+		uint offset = scan(sum);
+		if(index < numBlocks)
+			blockSums[index] = offset;
+		if(gl_LocalInvocationIndex == last)
+			nextAgents = offset + sum;
+	}
+}
@@ -1,11 +1,13 @@
-#version 460
+#version 450
 
-layout(local_size_x = 1) in;
+layout(local_size_x = 64) in;
 
 struct Agent {
 	vec2 pos;
 	float angleRadians;
 	uint species; // ∈ [0, 3]
+	float age; // seconds
+	float energy; // ∈ [0, 1]
 };
 
 struct Species {
@@ -18,13 +20,49 @@ struct Species {
 #define PI 3.1415926535897932384626433832795
 layout(location = 0) uniform float time; // as seed
 layout(location = 1) uniform float deltaTime;
-layout(location = 2) uniform uint numAgents;
 layout(location = 3) uniform uint overlapping;
 layout(location = 4) uniform Species _species[4];
+layout(location = 20) uniform uint firstAgent = 0;
+layout(location = 21) uniform uint stages = 3; // 1: move, 2: deposit
+layout(location = 22) uniform ivec2 origin = ivec2(0); // world position of texel (0, 0)
+layout(location = 23) uniform ivec2 worldSize = ivec2(0); // (0, 0) → size of image
+layout(location = 24) uniform bool measure = false; // statistics must be bound
+layout(location = 25) uniform bool lifecycle = false; // counts & children must be bound
+layout(location = 26) uniform float maxAge; // seconds
+layout(location = 27) uniform float starvationRate; // energy/second
+layout(location = 28) uniform float feedRate; // energy/second on a fully covered texel
+layout(location = 29) uniform float spawnEnergy; // needed to bud
+layout(location = 30) uniform float spawnDensity; // sensed trail needed to bud
+layout(location = 31) uniform bool markTiles = false; // occupancy must be bound
+layout(location = 32) uniform bool seedFromIds = false; // ids must be bound
 layout(binding = 0, rgba32f) uniform image2D image;
 layout(binding = 0, std430) buffer _block_name {
 	Agent agents[];
 };
+layout(binding = 1, std430) buffer _statistics_block {
+	uint _histograms[4 * 32];
+	uint _covered;
+	uint clamped; // agents clamped at borders
+	int _headingX, _headingY;
+	uint speed; // Σ pixels/second actually moved
+	uint _agentCount;
+	uint movedAgents;
+};
+layout(binding = 2, std430) readonly buffer _population_block {
+	uint liveAgents; // agents[firstAgent, firstAgent + liveAgents) are simulated
+};
+layout(binding = 3, std430) writeonly buffer _count_block {
+	uint counts[]; // agents continuing from each agent: 0 (died), 1, 2 (budded)
+};
+layout(binding = 4, std430) writeonly buffer _children_block {
+	Agent children[];
+};
+layout(binding = 8, std430) writeonly buffer _occupancy_block {
+	uint occupied[]; // per 32x32 tile of image, row-major
+};
+layout(binding = 10, std430) readonly buffer _id_block {
+	uint ids[]; // stable across reordering of agents
+};
 
 ivec4 _speciesMask(uint species) {
 	switch(species) {
@@ -35,11 +73,9 @@ ivec4 _speciesMask(uint species) {
 	}
 }
 
-const uint index = gl_GlobalInvocationID.x;
-const ivec2 size = imageSize(image);
-const ivec4 speciesMask = _speciesMask(agents[index].species);
-const ivec4 speciesMult = speciesMask * 2 - 1;
-const Species species = _species[agents[index].species];
+ivec4 speciesMask;
+ivec4 speciesMult;
+Species species;
 
 // Bob Jenkins
 void hash(inout uint state) {
@@ -50,8 +86,8 @@ void hash(inout uint state) {
 	state += (state << 15);
 }
 
-uint randomState() {
-	uint idx = index;
+uint randomState(uint id) {
+	uint idx = id;
 	uint micros = uint(time * 1000000);
 	hash(idx);
 	hash(micros);
@@ -71,7 +107,7 @@ float sense(vec2 pos, float angle) {
 	float sensed = 0;
 	for(int x = -1; x <= 1; ++x)
 		for(int y = -1; y <= 1; ++y)
-			sensed += dot(imageLoad(image, sensorPos + ivec2(x, y)), speciesMult);
+			sensed += dot(imageLoad(image, sensorPos + ivec2(x, y) - origin), speciesMult);
 	return sensed;
 }
 
@@ -93,18 +129,82 @@ void move(inout Agent agent, inout uint state) {
 	agent.pos += dir * moveDistance;
 }
 
-void main() {
-	if(index >= numAgents)
-		return;
+// returns number of agents continuing
+uint live(inout Agent agent, inout uint state, uint index) {
+	agent.age += deltaTime;
+	float food = dot(imageLoad(image, ivec2(agent.pos) - origin), speciesMask);
+	agent.energy = min(agent.energy + (feedRate * food - starvationRate) * deltaTime, 1);
+	if(agent.age >= maxAge || agent.energy <= 0)
+		return 0;
+	if(agent.energy < spawnEnergy || sense(agent.pos, agent.angleRadians) < spawnDensity)
+		return 1;
+	agent.energy /= 2;
+	Agent child = agent;
+	child.age = 0;
+	child.angleRadians = random01(state) * 2 * PI;
+	children[index] = child;
+	return 2;
+}
+
+shared vec2 partial[gl_WorkGroupSize.x]; // (speed, moved agents)
+
+// returns distance moved
+float simulate() {
+	uint index = gl_GlobalInvocationID.x + firstAgent;
+	ivec2 size = worldSize == ivec2(0) ? imageSize(image) : worldSize;
 	Agent agent = agents[index];
-	uint state = randomState();
-	move(agent, state);
-	if(agent.pos.x < 0 || agent.pos.y < 0 || agent.pos.x > size.x || agent.pos.y > size.y) {
-		agent.pos = clamp(agent.pos, vec2(0), size);
-		agent.angleRadians = random01(state) * 2 * PI; // new random angle
+	speciesMask = _speciesMask(agent.species);
+	speciesMult = speciesMask * 2 - 1;
+	species = _species[agent.species];
+	uint count = 1;
+	float moved = 0;
+	if((stages & 1) != 0) {
+		vec2 previous = agent.pos;
+		uint state = randomState(seedFromIds ? ids[index] : index);
+		move(agent, state);
+		if(agent.pos.x < 0 || agent.pos.y < 0 || agent.pos.x > size.x || agent.pos.y > size.y) {
+			agent.pos = clamp(agent.pos, vec2(0), size);
+			agent.angleRadians = random01(state) * 2 * PI; // new random angle
+			if(measure)
+				atomicAdd(clamped, 1);
+		}
+		moved = length(agent.pos - previous);
+		if(lifecycle) {
+			count = live(agent, state, index);
+			counts[index] = count;
+		}
+		agents[index] = agent;
 	}
-	agents[index] = agent;
-	ivec2 imageCoords = ivec2(agent.pos);
+	if((stages & 2) == 0 || count == 0)
+		return moved;
+	ivec2 imageCoords = ivec2(agent.pos) - origin;
 	vec4 trail = overlapping == 1 ? max(speciesMask + imageLoad(image, imageCoords), 1) : speciesMask;
 	imageStore(image, imageCoords, trail);
+	ivec2 imageExtent = imageSize(image);
+	if(markTiles && all(lessThan(uvec2(imageCoords), uvec2(imageExtent))))
+		occupied[imageCoords.y / 32 * ((imageExtent.x + 31) / 32) + imageCoords.x / 32] = 1;
+	return moved;
+}
+
+void main() {
+	vec2 value = vec2(0);
+	if(gl_GlobalInvocationID.x < liveAgents) {
+		float moved = simulate();
+		if((stages & 1) != 0 && deltaTime > 0)
+			value = vec2(moved / deltaTime, 1);
+	}
+	if(!measure)
+		return;
+	uint local = gl_LocalInvocationIndex;
+	partial[local] = value;
+	barrier();
+	for(uint stride = gl_WorkGroupSize.x / 2; stride > 0; stride /= 2) {
+		if(local < stride)
+			partial[local] += partial[local + stride];
+		barrier();
+	}
+	if(local != 0)
+		return;
+	atomicAdd(speed, uint(round(partial[0].x)));
+	atomicAdd(movedAgents, uint(partial[0].y));
 }
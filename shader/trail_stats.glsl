@@ -0,0 +1,43 @@
+#version 450
+
+layout(local_size_x = 16, local_size_y = 16) in;
+
+#define BINS 32u
+layout(binding = 0, rgba32f) uniform readonly image2D image;
+layout(binding = 1, std430) buffer _statistics_block {
+	uint histograms[4 * BINS]; // per species, texels by trail density
+	uint covered; // texels with any trail
+	uint clamped; // agents clamped at borders
+	int headingX, headingY; // Σ heading vectors, fixed point (1/256)
+	uint speed; // Σ pixels/second actually moved
+	uint agentCount;
+	uint movedAgents; // agents contributing to speed
+};
+
+shared uint localHistograms[4 * BINS];
+shared uint localCovered;
+
+void main() {
+	uint local = gl_LocalInvocationIndex;
+	if(local < 4 * BINS)
+		localHistograms[local] = 0;
+	if(local == 0)
+		localCovered = 0;
+	barrier();
+	ivec2 size = imageSize(image);
+	ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+	if(pos.x < size.x && pos.y < size.y) {
+		vec4 trail = imageLoad(image, pos);
+		if(any(greaterThan(trail, vec4(0))))
+			atomicAdd(localCovered, 1);
+		for(uint species = 0; species < 4; ++species)
+			if(trail[species] > 0)
+				atomicAdd(localHistograms[species * BINS + min(uint(trail[species] * BINS), BINS - 1)], 1);
+	}
+	barrier();
+	// one global atomic per bin & workgroup
+	if(local < 4 * BINS && localHistograms[local] != 0)
+		atomicAdd(histograms[local], localHistograms[local]);
+	if(local == 0 && localCovered != 0)
+		atomicAdd(covered, localCovered);
+}
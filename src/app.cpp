@@ -88,3 +88,7 @@ void render() noexcept {
 size framebuffer_size() noexcept {
 	return framebuffer.load(std::memory_order_relaxed);
 }
+
+float elapsed_time() noexcept {
+	return static_cast<float>(glfwGetTime());
+}
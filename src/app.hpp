@@ -9,5 +9,6 @@ void shutdown() noexcept;
 [[nodiscard]] bool new_frame() noexcept; // whether to keep running
 void render() noexcept;
 [[nodiscard]] size framebuffer_size() noexcept;
+[[nodiscard]] float elapsed_time() noexcept; // seconds
 
 #endif // CS_APP_HPP
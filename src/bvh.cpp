@@ -0,0 +1,84 @@
+#include "bvh.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+static std::span<sphere const> spheres;
+static std::span<bvh_node> nodes;
+static unsigned int next_internal, next_leaf;
+
+[[nodiscard]] static float area(float const (& min)[3], float const (& max)[3]) noexcept {
+	auto dx = max[0] - min[0];
+	auto dy = max[1] - min[1];
+	auto dz = max[2] - min[2];
+	return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+[[nodiscard]] static float center(sphere const & s, int axis) noexcept {
+	switch(axis) {
+	case 0: return s.x;
+	case 1: return s.y;
+	default: return s.z;
+	}
+}
+
+// returns index of node
+static unsigned int build(std::span<unsigned int> indices, unsigned int parent) noexcept {
+	if(indices.size() == 1) {
+		auto index = next_leaf++;
+		auto & s = spheres[indices[0]];
+		nodes[index] = {
+			{s.x - s.r, s.y - s.r, s.z - s.r}, indices[0],
+			{s.x + s.r, s.y + s.r, s.z + s.r}, 0,
+			parent, 0.0f, {},
+		};
+		return index;
+	}
+	float lo[3]{FLT_MAX, FLT_MAX, FLT_MAX}, hi[3]{-FLT_MAX, -FLT_MAX, -FLT_MAX};
+	for(auto i : indices)
+		for(int axis{}; axis < 3; ++axis) {
+			lo[axis] = std::min(lo[axis], center(spheres[i], axis));
+			hi[axis] = std::max(hi[axis], center(spheres[i], axis));
+		}
+	int axis{};
+	for(int a{1}; a < 3; ++a)
+		if(hi[a] - lo[a] > hi[axis] - lo[axis])
+			axis = a;
+	auto middle = indices.begin() + indices.size() / 2;
+	std::nth_element(indices.begin(), middle, indices.end(), [axis](auto a, auto b) {
+		return center(spheres[a], axis) < center(spheres[b], axis);
+	});
+	auto index = next_internal++;
+	auto left = build({indices.begin(), middle}, index);
+	auto right = build({middle, indices.end()}, index);
+	auto & l = nodes[left];
+	auto & r = nodes[right];
+	auto & node = nodes[index];
+	for(int a{}; a < 3; ++a) {
+		node.min[a] = std::min(l.min[a], r.min[a]);
+		node.max[a] = std::max(l.max[a], r.max[a]);
+	}
+	node.left = left;
+	node.right = right;
+	node.parent = parent;
+	node.cost = area(node.min, node.max) + l.cost + r.cost;
+	return index;
+}
+
+float build_bvh(std::span<sphere const> spheres, std::span<bvh_node> nodes) noexcept {
+	::spheres = spheres;
+	::nodes = nodes;
+	next_internal = 0;
+	next_leaf = static_cast<unsigned int>(spheres.size()) - 1;
+	std::vector<unsigned int> indices(spheres.size());
+	for(unsigned int i{}; i < indices.size(); ++i)
+		indices[i] = i;
+	build(indices, 0);
+	return bvh_quality(nodes[0]);
+}
+
+// expected number of internal nodes visited by a random ray hitting the root
+float bvh_quality(bvh_node const & root) noexcept {
+	auto root_area = area(root.min, root.max);
+	return root_area > 0.0f ? root.cost / root_area : 0.0f;
+}
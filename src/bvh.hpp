@@ -0,0 +1,28 @@
+#ifndef CS_BVH_HPP
+#define CS_BVH_HPP
+
+#include <span>
+
+struct sphere {
+	float x, y, z;
+	float r;
+};
+
+// matches Node in rt.glsl & refit.glsl (std430)
+// internal nodes occupy [0, n - 1) with the root at 0, leaves occupy [n - 1, 2n - 1)
+struct bvh_node {
+	float min[3];
+	unsigned int left; // leaf: index of sphere
+	float max[3];
+	unsigned int right;
+	unsigned int parent;
+	float cost; // summed surface area of internal nodes in subtree
+	unsigned int padding[2];
+};
+
+// nodes.size() must be at least 2 * spheres.size() - 1
+// returns quality of tree (lower is better)
+float build_bvh(std::span<sphere const> spheres, std::span<bvh_node> nodes) noexcept;
+[[nodiscard]] float bvh_quality(bvh_node const & root) noexcept;
+
+#endif // CS_BVH_HPP
@@ -1,16 +1,47 @@
 #ifndef CS_MANAGERS_HPP
 #define CS_MANAGERS_HPP
 
+#include "app.hpp"
+
 namespace slime {
+	struct config {
+		unsigned int num_agents;
+		unsigned int num_species; // ∈ [1, 4]
+		float decay_rate, diffuse_rate;
+		bool lifecycle; // agents die & bud, population drifts from num_agents
+		bool sparse; // postprocess only tiles with trail & their neighbors
+	};
+
+	struct statistics {
+		float histograms[4][32]; // per species, share of covered texels by trail density
+		float coverage; // share of texels with any trail
+		float mean_heading_radians;
+		float heading_coherence; // length of mean heading vector ∈ [0, 1]
+		float mean_speed; // pixels/second
+		unsigned int clamped_agents; // hit a border
+		unsigned int num_agents;
+	};
+
 	void init() noexcept;
 	void shutdown() noexcept;
 	void compute() noexcept;
+	void configure(config const & config) noexcept; // resets simulation, must be called after init()
+	[[nodiscard]] statistics const & latest_statistics() noexcept; // a few frames old, never waits for the GPU
 }
 
 namespace rt {
+	struct config {
+		unsigned int num_spheres; // ∈ [1, 16384]
+		bool animate;
+	};
+
 	void init() noexcept;
 	void shutdown() noexcept;
 	void compute() noexcept;
+	void configure(config const & config) noexcept; // must be called after init()
+	[[nodiscard]] unsigned int texture() noexcept; // displayed by render()
+	// framebuffer shows part of a larger picture at (x, y), picture of size (0, 0) → framebuffer
+	void set_view(int x, int y, size picture) noexcept;
 }
 
 #endif // CS_MANAGERS_HPP
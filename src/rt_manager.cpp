@@ -1,25 +1,51 @@
 #include "managers.hpp"
+#include <cstddef>
+#include <random>
 #include <glad/glad.h>
 #include <imgui.h>
 #include "app.hpp"
+#include "bvh.hpp"
 #include "shader.hpp"
 #include "shadersrc.hpp"
 
-struct sphere {
-	float x, y, z;
-	float r;
+// read back asynchronously to judge when refitting degraded the tree too much
+struct readback {
+	bvh_node root;
+	sphere selected;
 };
 
+static constexpr float box_min[3]{-3.0f, -3.0f, -10.0f};
+static constexpr float box_max[3]{3.0f, 3.0f, -1.0f};
+
+static constinit sphere spheres[1 << 14]{};
+static constinit float velocities[sizeof(spheres) / sizeof(*spheres)][4]{};
+static constinit bvh_node nodes[2 * sizeof(spheres) / sizeof(*spheres) - 1]{};
+static constinit GLuint max_num_spheres{sizeof(spheres) / sizeof(*spheres)};
+
 static float fov;
-static sphere s;
+static GLuint num_spheres;
+static GLuint selected;
+static bool animate;
+static float rebuild_threshold;
 
 static bool menu_open;
+static bool dirty; // spheres changed since last refit
+static float built_quality, quality;
+static unsigned int num_rebuilds;
 
+static std::mt19937 twister;
 static GLsizei width, height;
+static float last_time;
+static int view_x, view_y;
+static size picture;
 
-static GLuint ssbo;
+static GLuint sphere_ssbo, node_ssbo, velocity_ssbo, counter_ssbo, readback_buffer, sphere_readback_buffer;
+static GLsync readback_fence;
+static GLuint readback_selected;
+static GLsync rebuild_fence; // spheres copied to sphere_readback_buffer
+static GLuint rebuild_num_spheres; // becomes num_spheres once rebuilt
 static GLuint texture;
-static GLuint program;
+static GLuint program, refit_program;
 
 static void create_texture(GLsizei width, GLsizei height) noexcept {
 	::width = width;
@@ -31,6 +57,71 @@ static void create_texture(GLsizei width, GLsizei height) noexcept {
 	glBindTextureUnit(0, texture);
 }
 
+// spheres must be up to date
+static void rebuild() noexcept {
+	if(readback_fence) { // refers to old tree
+		glDeleteSync(readback_fence);
+		readback_fence = nullptr;
+	}
+	built_quality = quality = build_bvh({spheres, num_spheres}, nodes);
+	glNamedBufferSubData(node_ssbo, 0, (2 * num_spheres - 1) * sizeof(bvh_node), nodes);
+}
+
+// copies the spheres animated on the GPU, the tree is rebuilt a few frames later by poll_rebuild()
+static void request_rebuild(GLuint count) noexcept {
+	if(rebuild_fence) // superseded
+		glDeleteSync(rebuild_fence);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glCopyNamedBufferSubData(sphere_ssbo, sphere_readback_buffer, 0, 0, count * sizeof(sphere));
+	rebuild_num_spheres = count;
+	rebuild_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+static void cancel_rebuild() noexcept {
+	if(rebuild_fence)
+		glDeleteSync(rebuild_fence);
+	rebuild_fence = nullptr;
+}
+
+// never waits for the GPU
+static void poll_rebuild() noexcept {
+	if(!rebuild_fence)
+		return;
+	auto status = glClientWaitSync(rebuild_fence, 0, 0);
+	if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		return;
+	cancel_rebuild();
+	auto edited = spheres[selected];
+	glGetNamedBufferSubData(sphere_readback_buffer, 0, rebuild_num_spheres * sizeof(sphere), spheres);
+	if(!animate) // otherwise the CPU copy is authoritative
+		spheres[selected] = edited;
+	num_spheres = rebuild_num_spheres;
+	if(selected >= num_spheres)
+		selected = num_spheres - 1;
+	rebuild();
+	dirty = true; // spheres may have moved since they were copied
+	++num_rebuilds;
+}
+
+static void setup_scene() noexcept {
+	std::uniform_real_distribution<float>
+		xdist{box_min[0], box_max[0]},
+		ydist{box_min[1], box_max[1]},
+		zdist{box_min[2], box_max[2]},
+		rdist{0.05f, 0.2f},
+		vdist{-1.0f, 1.0f};
+	spheres[0] = {0.0f, 0.0f, -1.0f, 0.25f};
+	for(GLuint i{}; i < max_num_spheres; ++i) {
+		if(i)
+			spheres[i] = {xdist(twister), ydist(twister), zdist(twister), rdist(twister)};
+		for(int axis{}; axis < 3; ++axis)
+			velocities[i][axis] = vdist(twister);
+	}
+	glNamedBufferSubData(sphere_ssbo, 0, sizeof(spheres), spheres);
+	glNamedBufferSubData(velocity_ssbo, 0, sizeof(velocities), velocities);
+	rebuild();
+}
+
 static void imgui() noexcept {
 	if(ImGui::IsKeyPressed(ImGuiKey_S, false))
 		menu_open = !menu_open;
@@ -39,39 +130,156 @@ static void imgui() noexcept {
 	bool changed{};
 	if(ImGui::Begin("Settings", &menu_open)) {
 		ImGui::SliderFloat("FOV", &fov, 0.5f, 2.0f, nullptr, ImGuiSliderFlags_AlwaysClamp);
+		int count = static_cast<int>(rebuild_fence ? rebuild_num_spheres : num_spheres);
+		// the tree of the old count doesn't fit, it stays in use until the new one is built
+		if(ImGui::DragInt("Number of Spheres", &count, 16.0f, 1, static_cast<int>(max_num_spheres), nullptr, ImGuiSliderFlags_AlwaysClamp))
+			request_rebuild(count);
+		ImGui::Checkbox("Animate", &animate);
+		ImGui::DragFloat("Rebuild Threshold", &rebuild_threshold, 0.01f, 1.0f, 4.0f, nullptr, ImGuiSliderFlags_AlwaysClamp);
+		ImGui::Text("BVH Quality: %.2f (built %.2f, %u rebuilds)", quality, built_quality, num_rebuilds);
+		ImGui::Separator();
+		int index = static_cast<int>(selected);
+		if(ImGui::DragInt("Sphere", &index, 1.0f, 0, static_cast<int>(num_spheres) - 1, nullptr, ImGuiSliderFlags_AlwaysClamp))
+			selected = index;
+		auto & s = spheres[selected];
 		if(ImGui::DragFloat3("Position", &s.x, 0.01f)) changed = true;
 		if(ImGui::DragFloat("Radius", &s.r, 0.01f, 0.0f, FLT_MAX, nullptr, ImGuiSliderFlags_AlwaysClamp)) changed = true;
 	}
-	if(changed)
-		glNamedBufferSubData(ssbo, 0, sizeof(sphere), &s);
 	ImGui::End();
+	if(selected >= num_spheres)
+		selected = num_spheres - 1;
+	if(changed) {
+		glNamedBufferSubData(sphere_ssbo, selected * sizeof(sphere), sizeof(sphere), &spheres[selected]);
+		dirty = true;
+	}
+}
+
+// never waits for the GPU, the result of a refit is picked up a few frames later
+static void poll_quality() noexcept {
+	if(!readback_fence)
+		return;
+	auto status = glClientWaitSync(readback_fence, 0, 0);
+	if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		return;
+	glDeleteSync(readback_fence);
+	readback_fence = nullptr;
+	readback result;
+	glGetNamedBufferSubData(readback_buffer, 0, sizeof(result), &result);
+	if(animate) // otherwise the CPU copy is authoritative
+		spheres[readback_selected] = result.selected;
+	quality = bvh_quality(result.root);
+	if(quality > built_quality * rebuild_threshold && !rebuild_fence)
+		request_rebuild(num_spheres);
+}
+
+static void refit(float delta_time) noexcept {
+	glUseProgram(refit_program);
+	glUniform1f(0, delta_time);
+	glUniform1ui(1, num_spheres);
+	glUniform3fv(2, 1, box_min);
+	glUniform3fv(3, 1, box_max);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	glClearNamedBufferSubData(counter_ssbo, GL_R32UI, 0, (num_spheres - 1) * sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	glDispatchCompute(num_spheres / 64 + 1, 1, 1);
+	dirty = false;
+	if(readback_fence)
+		return;
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glCopyNamedBufferSubData(node_ssbo, readback_buffer, 0, offsetof(readback, root), sizeof(bvh_node));
+	glCopyNamedBufferSubData(sphere_ssbo, readback_buffer, selected * sizeof(sphere), offsetof(readback, selected), sizeof(sphere));
+	readback_selected = selected;
+	readback_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 }
 
 void rt::init() noexcept {
+	twister.seed(std::mt19937::default_seed); // same scene after every init()
 	fov = 1.0f;
-	s = {0.0f, 0.0f, -1.0f, 0.25f};
+	num_spheres = 1024;
+	selected = 0;
+	animate = false;
+	rebuild_threshold = 1.5f;
+	menu_open = false;
+	dirty = false;
+	num_rebuilds = 0;
+	view_x = view_y = 0;
+	picture = {0, 0};
+	last_time = elapsed_time();
 	auto [width, height] = framebuffer_size();
-	glGenBuffers(1, &ssbo);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssbo);
-	glNamedBufferData(ssbo, sizeof(sphere), &s, GL_STATIC_DRAW);
+	GLuint buffers[6];
+	glCreateBuffers(6, buffers);
+	sphere_ssbo = buffers[0];
+	node_ssbo = buffers[1];
+	velocity_ssbo = buffers[2];
+	counter_ssbo = buffers[3];
+	readback_buffer = buffers[4];
+	sphere_readback_buffer = buffers[5];
+	glNamedBufferData(sphere_ssbo, sizeof(spheres), nullptr, GL_DYNAMIC_COPY);
+	glNamedBufferData(node_ssbo, sizeof(nodes), nullptr, GL_DYNAMIC_COPY);
+	glNamedBufferData(velocity_ssbo, sizeof(velocities), nullptr, GL_DYNAMIC_COPY);
+	glNamedBufferData(counter_ssbo, max_num_spheres * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+	glNamedBufferData(readback_buffer, sizeof(readback), nullptr, GL_STREAM_READ);
+	glNamedBufferData(sphere_readback_buffer, sizeof(spheres), nullptr, GL_STREAM_READ);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, sphere_ssbo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, node_ssbo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, velocity_ssbo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, counter_ssbo);
+	setup_scene();
 	create_texture(width, height);
 	program = make_program(RT_GLSL);
+	refit_program = make_program(REFIT_GLSL);
 }
 
 void rt::shutdown() noexcept {
-	glDeleteBuffers(1, &ssbo);
-	glDeleteTextures(1, &texture);
+	if(readback_fence)
+		glDeleteSync(readback_fence);
+	readback_fence = nullptr;
+	cancel_rebuild();
+	GLuint buffers[]{sphere_ssbo, node_ssbo, velocity_ssbo, counter_ssbo, readback_buffer, sphere_readback_buffer};
+	glDeleteBuffers(6, buffers);
+	glDeleteTextures(1, &::texture);
 	glDeleteProgram(program);
+	glDeleteProgram(refit_program);
 }
 
 void rt::compute() noexcept {
+	auto time = elapsed_time();
+	auto delta_time = time - last_time;
+	last_time = time;
 	imgui();
+	poll_rebuild();
+	poll_quality();
+	if(animate || dirty)
+		refit(animate ? delta_time : 0.0f);
 	auto [width, height] = framebuffer_size();
 	if(::width != width || ::height != height) {
-		glDeleteTextures(1, &texture);
+		glDeleteTextures(1, &::texture);
 		create_texture(width, height);
 	}
 	glUseProgram(program);
 	glUniform1f(0, fov);
+	glUniform1ui(1, num_spheres);
+	glUniform2i(2, view_x, view_y);
+	glUniform2i(3, picture.width, picture.height);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 	glDispatchCompute(width / 8 + 1, height / 8 + 1, 1);
 }
+
+void rt::configure(config const & config) noexcept {
+	num_spheres = config.num_spheres < max_num_spheres ? config.num_spheres : max_num_spheres;
+	animate = config.animate;
+	selected = 0;
+	cancel_rebuild();
+	// setup, so waiting is fine
+	glGetNamedBufferSubData(sphere_ssbo, 0, num_spheres * sizeof(sphere), spheres);
+	rebuild();
+}
+
+unsigned int rt::texture() noexcept {
+	return ::texture;
+}
+
+void rt::set_view(int x, int y, size picture) noexcept {
+	view_x = x;
+	view_y = y;
+	::picture = picture;
+}
@@ -1,7 +1,5 @@
 #include "shader.hpp"
-#ifdef _DEBUG
 #include "app.hpp"
-#endif
 
 enum class shader_type : GLenum {
 	compute = GL_COMPUTE_SHADER,
@@ -9,11 +7,18 @@ enum class shader_type : GLenum {
 	fragment = GL_FRAGMENT_SHADER,
 };
 
+#ifdef _DEBUG
+static bool checked{true};
+#else
+static bool checked;
+#endif // _DEBUG
+
 [[nodiscard]] static GLuint make_shader(shader_type type, char const * source) noexcept {
 	auto shader = glCreateShader(static_cast<GLenum>(type));
 	glShaderSource(shader, 1, &source, nullptr);
 	glCompileShader(shader);
-#ifdef _DEBUG
+	if(!checked)
+		return shader;
 	GLint success;
 	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 	if(!success) {
@@ -21,13 +26,13 @@ enum class shader_type : GLenum {
 		glGetShaderInfoLog(shader, 1024, nullptr, buffer);
 		terminate(buffer);
 	}
-#endif // _DEBUG
 	return shader;
 }
 
 static void link_program(GLuint program) noexcept {
 	glLinkProgram(program);
-#ifdef _DEBUG
+	if(!checked)
+		return;
 	GLint success;
 	glGetProgramiv(program, GL_LINK_STATUS, &success);
 	if(!success) {
@@ -35,7 +40,6 @@ static void link_program(GLuint program) noexcept {
 		glGetProgramInfoLog(program, 1024, nullptr, buffer);
 		terminate(buffer);
 	}
-#endif // _DEBUG
 }
 
 GLuint make_program(char const * vertex_source, char const * fragment_source) noexcept {
@@ -72,6 +76,12 @@ shader_program::~shader_program() {
 	glDeleteProgram(_handle);
 }
 
+void check_shaders([[maybe_unused]] bool enabled) noexcept {
+#ifndef _DEBUG
+	checked = enabled;
+#endif // _DEBUG
+}
+
 void shader_program::use_program() const noexcept {
 	glUseProgram(_handle);
 }
@@ -5,6 +5,7 @@
 
 [[nodiscard]] GLuint make_program(char const * vertex_source, char const * fragment_source) noexcept;
 [[nodiscard]] GLuint make_program(char const * compute_source) noexcept;
+void check_shaders(bool enabled) noexcept; // terminate() on compile & link errors, always enabled in debug builds
 
 class shader_program {
 public:
@@ -1,5 +1,136 @@
+#define ACTIVE_TILES_GLSL \
+"#version 450\n" \
+"\n" \
+"layout(local_size_x = 8, local_size_y = 8) in;\n" \
+"\n" \
+"layout(location = 0) uniform ivec2 tileCount; // 32x32 tiles covering the image\n" \
+"layout(binding = 8, std430) readonly buffer _occupancy_block {\n" \
+"	uint occupied[];\n" \
+"};\n" \
+"layout(binding = 9, std430) buffer _active_tiles_block {\n" \
+"	uint activeGroups[3]; // indirect dispatch arguments of postprocess.glsl, must be (0, 1, 1) before\n" \
+"	uint activeTiles[];\n" \
+"};\n" \
+"\n" \
+"// occupied tiles and their neighbors, whose trail diffuses into them\n" \
+"void main() {\n" \
+"	ivec2 tile = ivec2(gl_GlobalInvocationID.xy);\n" \
+"	if(tile.x >= tileCount.x || tile.y >= tileCount.y)\n" \
+"		return;\n" \
+"	ivec2 lower = max(tile - 1, ivec2(0));\n" \
+"	ivec2 upper = min(tile + 1, tileCount - 1);\n" \
+"	for(int y = lower.y; y <= upper.y; ++y)\n" \
+"		for(int x = lower.x; x <= upper.x; ++x)\n" \
+"			if(occupied[y * tileCount.x + x] != 0) {\n" \
+"				activeTiles[atomicAdd(activeGroups[0], 1)] = tile.y * tileCount.x + tile.x;\n" \
+"				return;\n" \
+"			}\n" \
+"}\n" \
+""
+#define AGENT_STATS_GLSL \
+"#version 450\n" \
+"\n" \
+"layout(local_size_x = 256) in;\n" \
+"\n" \
+"struct Agent {\n" \
+"	vec2 pos;\n" \
+"	float angleRadians;\n" \
+"	uint species; // ∈ [0, 3]\n" \
+"	float age; // seconds\n" \
+"	float energy; // ∈ [0, 1]\n" \
+"};\n" \
+"\n" \
+"layout(binding = 0, std430) readonly buffer _block_name {\n" \
+"	Agent agents[];\n" \
+"};\n" \
+"layout(binding = 2, std430) readonly buffer _population_block {\n" \
+"	uint liveAgents;\n" \
+"};\n" \
+"layout(binding = 1, std430) buffer _statistics_block {\n" \
+"	uint histograms[4 * 32]; // per species, texels by trail density\n" \
+"	uint covered; // texels with any trail\n" \
+"	uint clamped; // agents clamped at borders\n" \
+"	int headingX, headingY; // Σ heading vectors, fixed point (1/256)\n" \
+"	uint speed; // Σ pixels/second actually moved, from slime.glsl\n" \
+"	uint agentCount;\n" \
+"	uint movedAgents;\n" \
+"};\n" \
+"\n" \
+"shared vec2 partial[gl_WorkGroupSize.x]; // heading\n" \
+"\n" \
+"void main() {\n" \
+"	uint index = gl_GlobalInvocationID.x;\n" \
+"	uint local = gl_LocalInvocationIndex;\n" \
+"	vec2 value = vec2(0);\n" \
+"	if(index < liveAgents) {\n" \
+"		Agent agent = agents[index];\n" \
+"		value = vec2(cos(agent.angleRadians), sin(agent.angleRadians));\n" \
+"	}\n" \
+"	partial[local] = value;\n" \
+"	barrier();\n" \
+"	for(uint stride = gl_WorkGroupSize.x / 2; stride > 0; stride /= 2) {\n" \
+"		if(local < stride)\n" \
+"			partial[local] += partial[local + stride];\n" \
+"		barrier();\n" \
+"	}\n" \
+"	if(local != 0)\n" \
+"		return;\n" \
+"	uint first = gl_WorkGroupID.x * gl_WorkGroupSize.x;\n" \
+"	atomicAdd(headingX, int(round(partial[0].x * 256)));\n" \
+"	atomicAdd(headingY, int(round(partial[0].y * 256)));\n" \
+"	atomicAdd(agentCount, min(liveAgents - first, gl_WorkGroupSize.x));\n" \
+"}\n" \
+""
+#define COMPACT_GLSL \
+"#version 450\n" \
+"\n" \
+"layout(local_size_x = 64) in;\n" \
+"\n" \
+"struct Agent {\n" \
+"	vec2 pos;\n" \
+"	float angleRadians;\n" \
+"	uint species; // ∈ [0, 3]\n" \
+"	float age; // seconds\n" \
+"	float energy; // ∈ [0, 1]\n" \
+"};\n" \
+"\n" \
+"layout(location = 0) uniform uint capacity;\n" \
+"layout(binding = 0, std430) readonly buffer _block_name {\n" \
+"	Agent agents[];\n" \
+"};\n" \
+"layout(binding = 2, std430) readonly buffer _population_block {\n" \
+"	uint liveAgents;\n" \
+"};\n" \
+"layout(binding = 3, std430) readonly buffer _count_block {\n" \
+"	uint counts[];\n" \
+"};\n" \
+"layout(binding = 4, std430) readonly buffer _children_block {\n" \
+"	Agent children[];\n" \
+"};\n" \
+"layout(binding = 5, std430) readonly buffer _offset_block {\n" \
+"	uint offsets[];\n" \
+"};\n" \
+"layout(binding = 6, std430) readonly buffer _block_sum_block {\n" \
+"	uint blockSums[];\n" \
+"};\n" \
+"layout(binding = 7, std430) writeonly buffer _compacted_block {\n" \
+"	Agent compacted[];\n" \
+"};\n" \
+"\n" \
+"void main() {\n" \
+"	uint index = gl_GlobalInvocationID.x;\n" \
+"	if(index >= liveAgents)\n" \
+"		return;\n" \
+"	uint count = counts[index];\n" \
+"	uint destination = offsets[index] + blockSums[index / 1024];\n" \
+"	if(count >= 1 && destination < capacity)\n" \
+"		compacted[destination] = agents[index];\n" \
+"	if(count == 2 && destination + 1 < capacity)\n" \
+"		compacted[destination + 1] = children[index];\n" \
+"}\n" \
+""
 #define COMPUTE_GLSL \
-"#version 460\n" \
+"#version 450\n" \
 "\n" \
 "layout(local_size_x = 1) in;\n" \
 "\n" \
@@ -13,7 +144,7 @@
 "}\n" \
 ""
 #define FRAGMENT_GLSL \
-"#version 460\n" \
+"#version 450\n" \
 "\n" \
 "in vec2 uvCoords;\n" \
 "layout(binding = 0) uniform sampler2D uSampler;\n" \
@@ -23,8 +154,30 @@
 "	outColor = texture(uSampler, uvCoords);\n" \
 "}\n" \
 ""
+#define POPULATION_GLSL \
+"#version 450\n" \
+"\n" \
+"layout(local_size_x = 1) in;\n" \
+"\n" \
+"layout(location = 0) uniform uint capacity;\n" \
+"layout(binding = 2, std430) buffer _population_block {\n" \
+"	uint liveAgents;\n" \
+"	uint nextAgents;\n" \
+"	uint simulateGroups[3]; // indirect dispatch arguments for workgroups of 64 agents\n" \
+"	uint scanGroups[3]; // 1024\n" \
+"	uint statisticsGroups[3]; // 256\n" \
+"};\n" \
+"\n" \
+"void main() {\n" \
+"	uint live = min(nextAgents, capacity);\n" \
+"	liveAgents = live;\n" \
+"	simulateGroups = uint[3]((live + 63) / 64, 1, 1);\n" \
+"	scanGroups = uint[3]((live + 1023) / 1024, 1, 1);\n" \
+"	statisticsGroups = uint[3]((live + 255) / 256, 1, 1);\n" \
+"}\n" \
+""
 #define POSTPROCESS_GLSL \
-"#version 460\n" \
+"#version 450\n" \
 "\n" \
 "layout(local_size_x = 32, local_size_y = 32) in;\n" \
 "\n" \
@@ -32,8 +185,20 @@
 "layout(location = 1) uniform float decayRate = 0.1; // must be non-negative\n" \
 "layout(location = 2) uniform float diffuseRate = 3; // must be non-negative\n" \
 "layout(location = 3) uniform vec3 species_colors[4];\n" \
+"layout(location = 7) uniform ivec2 offset = ivec2(0); // first processed texel\n" \
+"layout(location = 8) uniform ivec2 extent = ivec2(0); // processed texels, (0, 0) → size of image\n" \
+"layout(location = 9) uniform bool sparse = false; // one workgroup per active tile, occupancy & active tiles must be bound\n" \
 "layout(binding = 0, rgba32f) uniform image2D image;\n" \
 "layout(binding = 1, rgba32f) uniform image2D coloredImage;\n" \
+"layout(binding = 8, std430) writeonly buffer _occupancy_block {\n" \
+"	uint occupied[]; // per 32x32 tile of image, row-major\n" \
+"};\n" \
+"layout(binding = 9, std430) readonly buffer _active_tiles_block {\n" \
+"	uint _activeGroups[3];\n" \
+"	uint activeTiles[];\n" \
+"};\n" \
+"\n" \
+"shared bool nonEmpty;\n" \
 "\n" \
 "vec4 speciesMask(uint species) {\n" \
 "	switch(species) {\n" \
@@ -44,11 +209,8 @@
 "	}\n" \
 "}\n" \
 "\n" \
-"void main() {\n" \
-"	ivec2 size = imageSize(image);\n" \
-"	ivec2 pos = ivec2(gl_GlobalInvocationID.xy);\n" \
-"	if(pos.x >= size.x || pos.y >= size.y)\n" \
-"		return;\n" \
+"// returns the decayed trail\n" \
+"vec4 process(ivec2 pos, ivec2 size) {\n" \
 "	vec4 original = imageLoad(image, pos);\n" \
 "	vec4 sum = vec4(0);\n" \
 "	for(int x = -1; x <= 1; ++x)\n" \
@@ -62,10 +224,111 @@
 "	for(uint species = 0; species < 4; ++species)\n" \
 "		colored += dot(speciesMask(species), decayed) * species_colors[species];\n" \
 "	imageStore(coloredImage, pos, vec4(colored, 1));\n" \
+"	return decayed;\n" \
+"}\n" \
+"\n" \
+"void main() {\n" \
+"	ivec2 size = imageSize(image);\n" \
+"	if(!sparse) {\n" \
+"		ivec2 processed = extent == ivec2(0) ? size : extent;\n" \
+"		if(gl_GlobalInvocationID.x < processed.x && gl_GlobalInvocationID.y < processed.y)\n" \
+"			process(ivec2(gl_GlobalInvocationID.xy) + offset, size);\n" \
+"		return;\n" \
+"	}\n" \
+"	// tiles that stay inactive keep their last, empty, colored texels\n" \
+"	uint tile = activeTiles[gl_WorkGroupID.x];\n" \
+"	int tilesX = (size.x + 31) / 32;\n" \
+"	ivec2 pos = ivec2(tile % tilesX, tile / tilesX) * 32 + ivec2(gl_LocalInvocationID.xy);\n" \
+"	if(gl_LocalInvocationIndex == 0)\n" \
+"		nonEmpty = false;\n" \
+"	barrier();\n" \
+"	if(pos.x < size.x && pos.y < size.y && any(greaterThan(process(pos, size), vec4(0))))\n" \
+"		nonEmpty = true;\n" \
+"	barrier();\n" \
+"	if(gl_LocalInvocationIndex == 0)\n" \
+"		occupied[tile] = uint(nonEmpty);\n" \
+"}\n" \
+""
+#define REFIT_GLSL \
+"#version 450\n" \
+"\n" \
+"layout(local_size_x = 64) in;\n" \
+"\n" \
+"struct Sphere {\n" \
+"	vec4 data; // (center.xyz, radius)\n" \
+"};\n" \
+"\n" \
+"struct Node {\n" \
+"	vec3 lo;\n" \
+"	uint left; // leaf: index of sphere\n" \
+"	vec3 hi;\n" \
+"	uint right;\n" \
+"	uint parent;\n" \
+"	float cost; // summed surface area of internal nodes in subtree\n" \
+"};\n" \
+"\n" \
+"layout(location = 0) uniform float deltaTime; // 0 → only refit\n" \
+"layout(location = 1) uniform uint numSpheres;\n" \
+"layout(location = 2) uniform vec3 boxMin; // spheres bounce inside box\n" \
+"layout(location = 3) uniform vec3 boxMax;\n" \
+"layout(binding = 0, std430) buffer _sphere_block {\n" \
+"	Sphere spheres[];\n" \
+"};\n" \
+"layout(binding = 1, std430) coherent buffer _node_block {\n" \
+"	Node nodes[]; // internal nodes: [0, numSpheres - 1), leaves: [numSpheres - 1, 2 * numSpheres - 1)\n" \
+"};\n" \
+"layout(binding = 2, std430) buffer _velocity_block {\n" \
+"	vec4 velocities[]; // (velocity.xyz, unused)\n" \
+"};\n" \
+"layout(binding = 3, std430) buffer _counter_block {\n" \
+"	uint counters[]; // per internal node, must be zeroed\n" \
+"};\n" \
+"\n" \
+"float area(vec3 lo, vec3 hi) {\n" \
+"	vec3 d = hi - lo;\n" \
+"	return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);\n" \
+"}\n" \
+"\n" \
+"void main() {\n" \
+"	uint leaf = gl_GlobalInvocationID.x;\n" \
+"	if(leaf >= numSpheres)\n" \
+"		return;\n" \
+"	uint index = numSpheres - 1 + leaf;\n" \
+"	uint sphere = nodes[index].left;\n" \
+"	vec4 s = spheres[sphere].data;\n" \
+"	if(deltaTime != 0) {\n" \
+"		vec3 velocity = velocities[sphere].xyz;\n" \
+"		vec3 center = s.xyz + velocity * deltaTime;\n" \
+"		// reflect position & direction off the walls of the box\n" \
+"		vec3 below = max(boxMin - center, 0);\n" \
+"		vec3 above = max(center - boxMax, 0);\n" \
+"		center += 2 * below - 2 * above;\n" \
+"		velocity *= 1 - 2 * sign(below + above);\n" \
+"		s.xyz = clamp(center, boxMin, boxMax);\n" \
+"		spheres[sphere].data = s;\n" \
+"		velocities[sphere].xyz = velocity;\n" \
+"	}\n" \
+"	nodes[index].lo = s.xyz - s.w;\n" \
+"	nodes[index].hi = s.xyz + s.w;\n" \
+"	nodes[index].cost = 0;\n" \
+"	// the second child to arrive at a parent refits it, the first one stops\n" \
+"	while(index != 0) {\n" \
+"		index = nodes[index].parent;\n" \
+"		memoryBarrierBuffer();\n" \
+"		if(atomicAdd(counters[index], 1) == 0)\n" \
+"			return;\n" \
+"		Node left = nodes[nodes[index].left];\n" \
+"		Node right = nodes[nodes[index].right];\n" \
+"		vec3 lo = min(left.lo, right.lo);\n" \
+"		vec3 hi = max(left.hi, right.hi);\n" \
+"		nodes[index].lo = lo;\n" \
+"		nodes[index].hi = hi;\n" \
+"		nodes[index].cost = area(lo, hi) + left.cost + right.cost;\n" \
+"	}\n" \
 "}\n" \
 ""
 #define RT_GLSL \
-"#version 460\n" \
+"#version 450\n" \
 "\n" \
 "layout(local_size_x = 8, local_size_y = 8) in;\n" \
 "\n" \
@@ -73,11 +336,27 @@
 "	vec4 data; // (center.xyz, radius)\n" \
 "};\n" \
 "\n" \
+"struct Node {\n" \
+"	vec3 lo;\n" \
+"	uint left; // leaf: index of sphere\n" \
+"	vec3 hi;\n" \
+"	uint right;\n" \
+"	uint parent;\n" \
+"	float cost;\n" \
+"};\n" \
+"\n" \
+"#define INFINITY 1e30\n" \
 "layout(location = 0) uniform float fov = 1;\n" \
+"layout(location = 1) uniform uint numSpheres = 1;\n" \
+"layout(location = 2) uniform ivec2 offset = ivec2(0); // position of image in whole picture\n" \
+"layout(location = 3) uniform ivec2 pictureSize = ivec2(0); // (0, 0) → size of image\n" \
 "layout(binding = 0, rgba32f) uniform image2D image;\n" \
-"layout(binding = 0, std430) buffer _block_name {\n" \
+"layout(binding = 0, std430) readonly buffer _sphere_block {\n" \
 "	Sphere spheres[];\n" \
 "};\n" \
+"layout(binding = 1, std430) readonly buffer _node_block {\n" \
+"	Node nodes[]; // internal nodes: [0, numSpheres - 1), leaves: [numSpheres - 1, 2 * numSpheres - 1)\n" \
+"};\n" \
 "\n" \
 "// Circle defined by c & r: p: length(p-c)²=r²\n" \
 "// Ray defined by o & d: p: p=o+l*d\n" \
@@ -102,35 +381,131 @@
 "	return -numerator/2;\n" \
 "}\n" \
 "\n" \
+"bool hitsBox(vec3 o, vec3 invD, vec3 lo, vec3 hi, float closest) {\n" \
+"	vec3 t0 = (lo - o) * invD;\n" \
+"	vec3 t1 = (hi - o) * invD;\n" \
+"	vec3 tMin = min(t0, t1);\n" \
+"	vec3 tMax = max(t0, t1);\n" \
+"	float tNear = max(max(tMin.x, tMin.y), tMin.z);\n" \
+"	float tFar = min(min(tMax.x, tMax.y), tMax.z);\n" \
+"	return tNear <= tFar && tFar >= 0 && tNear < closest;\n" \
+"}\n" \
+"\n" \
+"// returns distance to closest sphere or -1\n" \
+"float trace(vec3 o, vec3 d, out vec3 center) {\n" \
+"	vec3 invD = 1 / d;\n" \
+"	float closest = INFINITY;\n" \
+"	uint firstLeaf = numSpheres - 1;\n" \
+"	uint stack[32];\n" \
+"	uint top = 0;\n" \
+"	stack[top++] = 0;\n" \
+"	while(top > 0) {\n" \
+"		uint index = stack[--top];\n" \
+"		Node node = nodes[index];\n" \
+"		if(!hitsBox(o, invD, node.lo, node.hi, closest))\n" \
+"			continue;\n" \
+"		if(index >= firstLeaf) {\n" \
+"			vec4 s = spheres[node.left].data;\n" \
+"			float t = distanceToSphere(o, d, s.xyz, s.w);\n" \
+"			if(t != -1 && t < closest) {\n" \
+"				closest = t;\n" \
+"				center = s.xyz;\n" \
+"			}\n" \
+"		} else if(top + 2 <= stack.length()) {\n" \
+"			stack[top++] = node.left;\n" \
+"			stack[top++] = node.right;\n" \
+"		}\n" \
+"	}\n" \
+"	return closest == INFINITY ? -1 : closest;\n" \
+"}\n" \
+"\n" \
 "void main() {\n" \
 "	ivec2 size = imageSize(image);\n" \
 "	if(gl_GlobalInvocationID.x >= size.x || gl_GlobalInvocationID.y >= size.y)\n" \
 "		return;\n" \
 "	ivec2 iC = ivec2(gl_GlobalInvocationID.xy);\n" \
-"	vec2 uv = iC / vec2(size - 1);\n" \
+"	ivec2 picture = pictureSize == ivec2(0) ? size : pictureSize;\n" \
+"	vec2 uv = (iC + offset) / vec2(picture - 1);\n" \
 "\n" \
 "	vec3 origin = vec3(0);\n" \
 "	float maxX = tan(fov / 2);\n" \
-"	vec2 max = {maxX, maxX * size.y / size.x};\n" \
+"	vec2 max = {maxX, maxX * picture.y / picture.x};\n" \
 "	vec3 dir = normalize(vec3((2 * uv - 1) * max, -1));\n" \
-"	vec4 s = spheres[0].data;\n" \
-"	vec3 c = s.xyz;\n" \
-"	float r = s.w;\n" \
+"	vec3 c;\n" \
 "\n" \
-"	float d = distanceToSphere(origin, dir, c, r);\n" \
+"	float d = trace(origin, dir, c);\n" \
 "	vec3 col = d == -1 ? vec3(0) : abs(normalize(origin + d * dir - c));\n" \
 "	imageStore(image, iC, vec4(col, 1));\n" \
 "}\n" \
 ""
+#define SCAN_GLSL \
+"#version 450\n" \
+"\n" \
+"layout(local_size_x = 1024) in;\n" \
+"\n" \
+"layout(location = 0) uniform uint level; // 0: counts of agents, 1: sums of level 0 blocks\n" \
+"layout(binding = 2, std430) buffer _population_block {\n" \
+"	uint liveAgents;\n" \
+"	uint nextAgents; // set by level 1\n" \
+"};\n" \
+"layout(binding = 3, std430) readonly buffer _count_block {\n" \
+"	uint counts[];\n" \
+"};\n" \
+"layout(binding = 5, std430) writeonly buffer _offset_block {\n" \
+"	uint offsets[]; // exclusive prefix sum of counts within block\n" \
+"};\n" \
+"layout(binding = 6, std430) buffer _block_sum_block {\n" \
+"	uint blockSums[]; // level 0: sum of block, level 1: exclusive prefix sum\n" \
+"};\n" \
+"\n" \
+"shared uint values[gl_WorkGroupSize.x];\n" \
+"\n" \
+"// Hillis & Steele, returns exclusive prefix sum within workgroup\n" \
+"uint scan(uint value) {\n" \
+"	uint local = gl_LocalInvocationIndex;\n" \
+"	values[local] = value;\n" \
+"	barrier();\n" \
+"	for(uint offset = 1; offset < gl_WorkGroupSize.x; offset *= 2) {\n" \
+"		uint addend = local >= offset ? values[local - offset] : 0;\n" \
+"		barrier();\n" \
+"		values[local] += addend;\n" \
+"		barrier();\n" \
+"	}\n" \
+"	return values[local] - value;\n" \
+"}\n" \
+"\n" \
+"void main() {\n" \
+"	uint index = gl_GlobalInvocationID.x;\n" \
+"	uint last = gl_WorkGroupSize.x - 1;\n" \
+"	if(level == 0) {\n" \
+"		uint count = index < liveAgents ? counts[index] : 0;\n" \
+"		uint offset = scan(count);\n" \
+"		if(index < liveAgents)\n" \
+"			offsets[index] = offset;\n" \
+"		if(gl_LocalInvocationIndex == last)\n" \
+"			blockSums[gl_WorkGroupID.x] = offset + count;\n" \
+"	} else {\n" \
+"		uint numBlocks = (liveAgents + last) / gl_WorkGroupSize.x;\n" \
+"		uint sum = index < numBlocks ? blockSums[index] : 0;\n" \
+"		uint offset = scan(sum);\n" \
+"		if(index < numBlocks)\n" \
+"			blockSums[index] = offset;\n" \
+"		if(gl_LocalInvocationIndex == last)\n" \
+"			nextAgents = offset + sum;\n" \
+"	}\n" \
+"}\n" \
+""
 #define SLIME_GLSL \
-"#version 460\n" \
+"#version 450\n" \
 "\n" \
-"layout(local_size_x = 1) in;\n" \
+"layout(local_size_x = 64) in;\n" \
 "\n" \
 "struct Agent {\n" \
 "	vec2 pos;\n" \
 "	float angleRadians;\n" \
 "	uint species; // ∈ [0, 3]\n" \
+"	float age; // seconds\n" \
+"	float energy; // ∈ [0, 1]\n" \
 "};\n" \
 "\n" \
 "struct Species {\n" \
@@ -143,13 +518,49 @@
 "#define PI 3.1415926535897932384626433832795\n" \
 "layout(location = 0) uniform float time; // as seed\n" \
 "layout(location = 1) uniform float deltaTime;\n" \
-"layout(location = 2) uniform uint numAgents;\n" \
 "layout(location = 3) uniform uint overlapping;\n" \
 "layout(location = 4) uniform Species _species[4];\n" \
+"layout(location = 20) uniform uint firstAgent = 0;\n" \
+"layout(location = 21) uniform uint stages = 3; // 1: move, 2: deposit\n" \
+"layout(location = 22) uniform ivec2 origin = ivec2(0); // world position of texel (0, 0)\n" \
+"layout(location = 23) uniform ivec2 worldSize = ivec2(0); // (0, 0) → size of image\n" \
+"layout(location = 24) uniform bool measure = false; // statistics must be bound\n" \
+"layout(location = 25) uniform bool lifecycle = false; // counts & children must be bound\n" \
+"layout(location = 26) uniform float maxAge; // seconds\n" \
+"layout(location = 27) uniform float starvationRate; // energy/second\n" \
+"layout(location = 28) uniform float feedRate; // energy/second on a fully covered texel\n" \
+"layout(location = 29) uniform float spawnEnergy; // needed to bud\n" \
+"layout(location = 30) uniform float spawnDensity; // sensed trail needed to bud\n" \
+"layout(location = 31) uniform bool markTiles = false; // occupancy must be bound\n" \
+"layout(location = 32) uniform bool seedFromIds = false; // ids must be bound\n" \
 "layout(binding = 0, rgba32f) uniform image2D image;\n" \
 "layout(binding = 0, std430) buffer _block_name {\n" \
 "	Agent agents[];\n" \
 "};\n" \
+"layout(binding = 1, std430) buffer _statistics_block {\n" \
+"	uint _histograms[4 * 32];\n" \
+"	uint _covered;\n" \
+"	uint clamped; // agents clamped at borders\n" \
+"	int _headingX, _headingY;\n" \
+"	uint speed; // Σ pixels/second actually moved\n" \
+"	uint _agentCount;\n" \
+"	uint movedAgents;\n" \
+"};\n" \
+"layout(binding = 2, std430) readonly buffer _population_block {\n" \
+"	uint liveAgents; // agents[firstAgent, firstAgent + liveAgents) are simulated\n" \
+"};\n" \
+"layout(binding = 3, std430) writeonly buffer _count_block {\n" \
+"	uint counts[]; // agents continuing from each agent: 0 (died), 1, 2 (budded)\n" \
+"};\n" \
+"layout(binding = 4, std430) writeonly buffer _children_block {\n" \
+"	Agent children[];\n" \
+"};\n" \
+"layout(binding = 8, std430) writeonly buffer _occupancy_block {\n" \
+"	uint occupied[]; // per 32x32 tile of image, row-major\n" \
+"};\n" \
+"layout(binding = 10, std430) readonly buffer _id_block {\n" \
+"	uint ids[]; // stable across reordering of agents\n" \
+"};\n" \
 "\n" \
 "ivec4 _speciesMask(uint species) {\n" \
 "	switch(species) {\n" \
@@ -160,11 +571,9 @@
 "	}\n" \
 "}\n" \
 "\n" \
-"const uint index = gl_GlobalInvocationID.x;\n" \
-"const ivec2 size = imageSize(image);\n" \
-"const ivec4 speciesMask = _speciesMask(agents[index].species);\n" \
-"const ivec4 speciesMult = speciesMask * 2 - 1;\n" \
-"const Species species = _species[agents[index].species];\n" \
+"ivec4 speciesMask;\n" \
+"ivec4 speciesMult;\n" \
+"Species species;\n" \
 "\n" \
 "// Bob Jenkins\n" \
 "void hash(inout uint state) {\n" \
@@ -175,8 +584,8 @@
 "	state += (state << 15);\n" \
 "}\n" \
 "\n" \
-"uint randomState() {\n" \
-"	uint idx = index;\n" \
+"uint randomState(uint id) {\n" \
+"	uint idx = id;\n" \
 "	uint micros = uint(time * 1000000);\n" \
 "	hash(idx);\n" \
 "	hash(micros);\n" \
@@ -196,7 +605,7 @@
 "	float sensed = 0;\n" \
 "	for(int x = -1; x <= 1; ++x)\n" \
 "		for(int y = -1; y <= 1; ++y)\n" \
-"			sensed += dot(imageLoad(image, sensorPos + ivec2(x, y)), speciesMult);\n" \
+"			sensed += dot(imageLoad(image, sensorPos + ivec2(x, y) - origin), speciesMult);\n" \
 "	return sensed;\n" \
 "}\n" \
 "\n" \
@@ -218,24 +627,133 @@
 "	agent.pos += dir * moveDistance;\n" \
 "}\n" \
 "\n" \
-"void main() {\n" \
-"	if(index >= numAgents)\n" \
-"		return;\n" \
+"// returns number of agents continuing\n" \
+"uint live(inout Agent agent, inout uint state, uint index) {\n" \
+"	agent.age += deltaTime;\n" \
+"	float food = dot(imageLoad(image, ivec2(agent.pos) - origin), speciesMask);\n" \
+"	agent.energy = min(agent.energy + (feedRate * food - starvationRate) * deltaTime, 1);\n" \
+"	if(agent.age >= maxAge || agent.energy <= 0)\n" \
+"		return 0;\n" \
+"	if(agent.energy < spawnEnergy || sense(agent.pos, agent.angleRadians) < spawnDensity)\n" \
+"		return 1;\n" \
+"	agent.energy /= 2;\n" \
+"	Agent child = agent;\n" \
+"	child.age = 0;\n" \
+"	child.angleRadians = random01(state) * 2 * PI;\n" \
+"	children[index] = child;\n" \
+"	return 2;\n" \
+"}\n" \
+"\n" \
+"shared vec2 partial[gl_WorkGroupSize.x]; // (speed, moved agents)\n" \
+"\n" \
+"// returns distance moved\n" \
+"float simulate() {\n" \
+"	uint index = gl_GlobalInvocationID.x + firstAgent;\n" \
+"	ivec2 size = worldSize == ivec2(0) ? imageSize(image) : worldSize;\n" \
 "	Agent agent = agents[index];\n" \
-"	uint state = randomState();\n" \
-"	move(agent, state);\n" \
-"	if(agent.pos.x < 0 || agent.pos.y < 0 || agent.pos.x > size.x || agent.pos.y > size.y) {\n" \
-"		agent.pos = clamp(agent.pos, vec2(0), size);\n" \
-"		agent.angleRadians = random01(state) * 2 * PI; // new random angle\n" \
+"	speciesMask = _speciesMask(agent.species);\n" \
+"	speciesMult = speciesMask * 2 - 1;\n" \
+"	species = _species[agent.species];\n" \
+"	uint count = 1;\n" \
+"	float moved = 0;\n" \
+"	if((stages & 1) != 0) {\n" \
+"		vec2 previous = agent.pos;\n" \
+"		uint state = randomState(seedFromIds ? ids[index] : index);\n" \
+"		move(agent, state);\n" \
+"		if(agent.pos.x < 0 || agent.pos.y < 0 || agent.pos.x > size.x || agent.pos.y > size.y) {\n" \
+"			agent.pos = clamp(agent.pos, vec2(0), size);\n" \
+"			agent.angleRadians = random01(state) * 2 * PI; // new random angle\n" \
+"			if(measure)\n" \
+"				atomicAdd(clamped, 1);\n" \
+"		}\n" \
+"		moved = length(agent.pos - previous);\n" \
+"		if(lifecycle) {\n" \
+"			count = live(agent, state, index);\n" \
+"			counts[index] = count;\n" \
+"		}\n" \
+"		agents[index] = agent;\n" \
 "	}\n" \
-"	agents[index] = agent;\n" \
-"	ivec2 imageCoords = ivec2(agent.pos);\n" \
+"	if((stages & 2) == 0 || count == 0)\n" \
+"		return moved;\n" \
+"	ivec2 imageCoords = ivec2(agent.pos) - origin;\n" \
 "	vec4 trail = overlapping == 1 ? max(speciesMask + imageLoad(image, imageCoords), 1) : speciesMask;\n" \
 "	imageStore(image, imageCoords, trail);\n" \
+"	ivec2 imageExtent = imageSize(image);\n" \
+"	if(markTiles && all(lessThan(uvec2(imageCoords), uvec2(imageExtent))))\n" \
+"		occupied[imageCoords.y / 32 * ((imageExtent.x + 31) / 32) + imageCoords.x / 32] = 1;\n" \
+"	return moved;\n" \
+"}\n" \
+"\n" \
+"void main() {\n" \
+"	vec2 value = vec2(0);\n" \
+"	if(gl_GlobalInvocationID.x < liveAgents) {\n" \
+"		float moved = simulate();\n" \
+"		if((stages & 1) != 0 && deltaTime > 0)\n" \
+"			value = vec2(moved / deltaTime, 1);\n" \
+"	}\n" \
+"	if(!measure)\n" \
+"		return;\n" \
+"	uint local = gl_LocalInvocationIndex;\n" \
+"	partial[local] = value;\n" \
+"	barrier();\n" \
+"	for(uint stride = gl_WorkGroupSize.x / 2; stride > 0; stride /= 2) {\n" \
+"		if(local < stride)\n" \
+"			partial[local] += partial[local + stride];\n" \
+"		barrier();\n" \
+"	}\n" \
+"	if(local != 0)\n" \
+"		return;\n" \
+"	atomicAdd(speed, uint(round(partial[0].x)));\n" \
+"	atomicAdd(movedAgents, uint(partial[0].y));\n" \
+"}\n" \
+""
+#define TRAIL_STATS_GLSL \
+"#version 450\n" \
+"\n" \
+"layout(local_size_x = 16, local_size_y = 16) in;\n" \
+"\n" \
+"#define BINS 32u\n" \
+"layout(binding = 0, rgba32f) uniform readonly image2D image;\n" \
+"layout(binding = 1, std430) buffer _statistics_block {\n" \
+"	uint histograms[4 * BINS]; // per species, texels by trail density\n" \
+"	uint covered; // texels with any trail\n" \
+"	uint clamped; // agents clamped at borders\n" \
+"	int headingX, headingY; // Σ heading vectors, fixed point (1/256)\n" \
+"	uint speed; // Σ pixels/second actually moved\n" \
+"	uint agentCount;\n" \
+"	uint movedAgents; // agents contributing to speed\n" \
+"};\n" \
+"\n" \
+"shared uint localHistograms[4 * BINS];\n" \
+"shared uint localCovered;\n" \
+"\n" \
+"void main() {\n" \
+"	uint local = gl_LocalInvocationIndex;\n" \
+"	if(local < 4 * BINS)\n" \
+"		localHistograms[local] = 0;\n" \
+"	if(local == 0)\n" \
+"		localCovered = 0;\n" \
+"	barrier();\n" \
+"	ivec2 size = imageSize(image);\n" \
+"	ivec2 pos = ivec2(gl_GlobalInvocationID.xy);\n" \
+"	if(pos.x < size.x && pos.y < size.y) {\n" \
+"		vec4 trail = imageLoad(image, pos);\n" \
+"		if(any(greaterThan(trail, vec4(0))))\n" \
+"			atomicAdd(localCovered, 1);\n" \
+"		for(uint species = 0; species < 4; ++species)\n" \
+"			if(trail[species] > 0)\n" \
+"				atomicAdd(localHistograms[species * BINS + min(uint(trail[species] * BINS), BINS - 1)], 1);\n" \
+"	}\n" \
+"	barrier();\n" \
+"	// one global atomic per bin & workgroup\n" \
+"	if(local < 4 * BINS && localHistograms[local] != 0)\n" \
+"		atomicAdd(histograms[local], localHistograms[local]);\n" \
+"	if(local == 0 && localCovered != 0)\n" \
+"		atomicAdd(covered, localCovered);\n" \
 "}\n" \
 ""
 #define VERTEX_GLSL \
-"#version 460\n" \
+"#version 450\n" \
 "\n" \
 "layout(location = 0) in vec2 inPos;\n" \
 "out vec2 uvCoords;\n" \
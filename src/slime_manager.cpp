@@ -1,18 +1,30 @@
 #include "managers.hpp"
 #include <cmath>
+#include <cstddef>
 #include <numbers>
 #include <random>
 #include <glad/glad.h>
-#include <GLFW/glfw3.h>
 #include <imgui.h>
 #include "app.hpp"
 #include "shader.hpp"
 #include "shadersrc.hpp"
+#include "slime_statistics.hpp"
 
 struct agent {
 	float x, y; // pixels
 	float angle_radians;
 	unsigned int species; // ∈ [0, 3]
+	float age; // seconds
+	float energy; // ∈ [0, 1]
+};
+
+// matches _population_block in population.glsl
+struct population {
+	GLuint live_agents;
+	GLuint next_agents;
+	GLuint simulate_groups[3]; // indirect dispatch arguments for workgroups of 64 agents
+	GLuint scan_groups[3]; // 1024
+	GLuint statistics_groups[3]; // 256
 };
 
 struct species_t {
@@ -25,6 +37,7 @@ struct species_t {
 
 static constinit agent agents[1'000'000]{};
 static constinit GLuint max_num_agents{sizeof(agents) / sizeof(*agents)};
+static_assert(sizeof(agents) / sizeof(*agents) <= 1024 * 1024, "scan.glsl has two levels of 1024");
 static constinit species_t species[4]{{{1.0f, 1.0f, 1.0f}}};
 
 static bool menu_open;
@@ -33,29 +46,65 @@ static float decay_rate, diffuse_rate;
 static bool overlapping;
 static GLuint num_species;
 static void (* setup_function)() noexcept;
+static bool reset_requested;
+static bool lifecycle;
+static bool sparse;
+static float max_age, starvation_rate, feed_rate, spawn_energy, spawn_density;
 
 static std::mt19937 twister;
 static GLsizei width, height;
 static float last_time;
 
-static GLuint ssbo;
+static GLuint agent_ssbos[2]; // compaction alternates between them
+static unsigned int current; // index of agent_ssbos holding live agents
+static GLuint population_buffer, count_ssbo, children_ssbo, offset_ssbo, block_sum_ssbo;
+static GLsizei tiles_x, tiles_y; // 32x32 tiles covering the textures
+static GLuint occupancy_ssbo, active_tile_buffer;
 static GLuint textures[2];
 // static constexpr auto & [trail_texture, colored_texture] = textures;
 static constexpr auto & trail_texture = textures[0];
 static constexpr auto & colored_texture = textures[1];
 static GLuint simulation_program, postprocess_program;
+static GLuint scan_program, compact_program, population_program;
+static GLuint active_tiles_program;
 
 static void create_textures() noexcept {
 	glCreateTextures(GL_TEXTURE_2D, 2, textures);
 	glTextureStorage2D(trail_texture, 1, GL_RGBA32F, width, height);
 	glTextureStorage2D(colored_texture, 1, GL_RGBA32F, width, height);
-	glClearTexImage(trail_texture, 0, GL_RGBA, GL_FLOAT, nullptr);
 	//                                    layered layer            shader store format
 	glBindImageTexture(0, trail_texture, 0, false, 0, GL_READ_WRITE, GL_RGBA32F);
 	glBindImageTexture(1, colored_texture, 0, false, 0, GL_WRITE_ONLY, GL_RGBA32F);
 	glBindTextureUnit(0, colored_texture);
 }
 
+// postprocess.glsl skips tiles without trail, their colored texels must already be cleared
+static void clear_trail() noexcept {
+	glClearTexImage(trail_texture, 0, GL_RGBA, GL_FLOAT, nullptr);
+	glClearTexImage(colored_texture, 0, GL_RGBA, GL_FLOAT, nullptr);
+	glClearNamedBufferData(occupancy_ssbo, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+}
+
+static void create_tiles() noexcept {
+	tiles_x = (width + 31) / 32;
+	tiles_y = (height + 31) / 32;
+	auto num_tiles = static_cast<GLsizeiptr>(tiles_x) * tiles_y;
+	GLuint buffers[2];
+	glCreateBuffers(2, buffers);
+	occupancy_ssbo = buffers[0];
+	active_tile_buffer = buffers[1];
+	glNamedBufferData(occupancy_ssbo, num_tiles * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+	glNamedBufferData(active_tile_buffer, (3 + num_tiles) * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, occupancy_ssbo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, active_tile_buffer);
+}
+
+// tiles may hold trail the occupancy doesn't know about
+static void mark_all_tiles() noexcept {
+	GLuint occupied{1};
+	glClearNamedBufferData(occupancy_ssbo, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &occupied);
+}
+
 static void setup_uniform() noexcept {
 	std::uniform_real_distribution<float>
 		xdist{0.0f, static_cast<float>(width)},
@@ -92,6 +141,39 @@ static void setup_circle() noexcept {
 	}
 }
 
+// ages are spread so agents don't die at once
+static void setup_lifecycle() noexcept {
+	std::uniform_real_distribution<float> agedist{0.0f, max_age};
+	for(GLuint i{}; i < max_num_agents; ++i) {
+		agents[i].age = agedist(twister);
+		agents[i].energy = 1.0f;
+	}
+}
+
+// first num_agents agents become live
+static void reset_population() noexcept {
+	population p{num_agents, num_agents, {(num_agents + 63) / 64, 1, 1}, {(num_agents + 1023) / 1024, 1, 1}, {(num_agents + 255) / 256, 1, 1}};
+	glNamedBufferSubData(population_buffer, 0, sizeof(p), &p);
+}
+
+// keeps the trail & live agents, added agents come from the last setup
+static void resize_population(GLuint previous_num_agents) noexcept {
+	if(num_agents > previous_num_agents)
+		glNamedBufferSubData(agent_ssbos[current], previous_num_agents * sizeof(agent), (num_agents - previous_num_agents) * sizeof(agent), agents + previous_num_agents);
+	reset_population();
+}
+
+static void bind_agent_ssbos() noexcept {
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, agent_ssbos[current]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, agent_ssbos[1 - current]);
+}
+
+static void assign_species() noexcept {
+	std::uniform_int_distribution<int> dist{0, num_species > 1 ? static_cast<int>(num_species) - 1 : 0};
+	for(GLuint i{}; i < max_num_agents; ++i)
+		agents[i].species = dist(twister);
+}
+
 static bool draw_uint(char const * label, GLuint & value, unsigned int step, int max) noexcept {
 	int x = static_cast<int>(value);
 	auto r = ImGui::DragInt(label, &x, static_cast<float>(step), 0, max, nullptr, ImGuiSliderFlags_AlwaysClamp);
@@ -118,13 +200,21 @@ static bool draw_symmetric_float(char const * label, float & value, float abs) n
 		menu_open = !menu_open;
 	if(!menu_open)
 		return false;
-	bool species_changed;
+	bool species_changed{};
 	if(ImGui::Begin("Settings", &menu_open)) {
 		ImGui::Text("General");
-		draw_uint("Number of Agents", num_agents, 100, max_num_agents);
+		auto previous_num_agents = num_agents;
+		if(draw_uint("Number of Agents", num_agents, 100, max_num_agents)) {
+			if(lifecycle) // live count is only known to the GPU
+				reset_requested = true;
+			else
+				resize_population(previous_num_agents);
+		}
 		draw_positive_float("Decay Rate", decay_rate, 0.01f);
 		draw_positive_float("Diffuse Rate", diffuse_rate, 0.05f);
 		ImGui::Checkbox("Overlapping", &overlapping);
+		if(ImGui::Checkbox("Sparse Postprocess", &sparse) && sparse)
+			mark_all_tiles();
 		species_changed = draw_uint("Number of Species", num_species, 1, 4);
 		for(unsigned char i{}; i < num_species; ++i) {
 			ImGui::Separator();
@@ -139,16 +229,56 @@ static bool draw_symmetric_float(char const * label, float & value, float abs) n
 			draw_float("Sensor Distance", s.sensor_distance, 0.05f);
 			ImGui::PopID();
 		}
+		ImGui::Separator();
+		ImGui::Text("Lifecycle");
+		ImGui::Checkbox("Enabled", &lifecycle);
+		draw_positive_float("Max Age", max_age, 0.5f);
+		draw_positive_float("Starvation Rate", starvation_rate, 0.01f);
+		draw_positive_float("Feed Rate", feed_rate, 0.01f);
+		draw_float("Spawn Energy", spawn_energy, 1.0f);
+		draw_positive_float("Spawn Density", spawn_density, 0.1f);
+		ImGui::Separator();
+		slime::stats::imgui();
 	}
 	ImGui::End();
-	if(species_changed) {
-		std::uniform_int_distribution<int> dist{0, static_cast<int>(num_species)};
-		for(GLuint i{}; i < max_num_agents; ++i)
-			agents[i].species = dist(twister);
-	}
+	if(species_changed)
+		assign_species();
 	return species_changed;
 }
 
+// moves surviving & budded agents to the front of the other agent buffer, which becomes current
+// the live count never leaves the GPU
+static void compact() noexcept {
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	glUseProgram(scan_program);
+	glUniform1ui(0, 0);
+	glDispatchComputeIndirect(offsetof(population, scan_groups));
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	glUniform1ui(0, 1);
+	glDispatchCompute(1, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	glUseProgram(compact_program);
+	glUniform1ui(0, max_num_agents);
+	glDispatchComputeIndirect(offsetof(population, simulate_groups));
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	glUseProgram(population_program);
+	glUniform1ui(0, max_num_agents);
+	glDispatchCompute(1, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+	current = 1 - current;
+	bind_agent_ssbos();
+}
+
+// occupied tiles & their neighbors become the workgroups of postprocess.glsl
+static void list_active_tiles() noexcept {
+	static constexpr GLuint no_groups[3]{0, 1, 1};
+	glNamedBufferSubData(active_tile_buffer, 0, sizeof(no_groups), no_groups);
+	glUseProgram(active_tiles_program);
+	glUniform2i(0, tiles_x, tiles_y);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	glDispatchCompute(tiles_x / 8 + 1, tiles_y / 8 + 1, 1);
+}
+
 // returns whether reset occured
 [[nodiscard]] static bool prepare() noexcept {
 	auto sub_needed = imgui();
@@ -157,56 +287,107 @@ static bool draw_symmetric_float(char const * label, float & value, float abs) n
 		::width = width;
 		::height = height;
 		glDeleteTextures(2, textures);
+		GLuint buffers[]{occupancy_ssbo, active_tile_buffer};
+		glDeleteBuffers(2, buffers);
 		create_textures();
+		create_tiles();
+		clear_trail();
 	} else {
 		if(ImGui::IsKeyPressed(ImGuiKey_C, false))
 			setup_function = setup_circle;
 		else if(ImGui::IsKeyPressed(ImGuiKey_V, false))
 			setup_function = setup_uniform;
-		else if(!sub_needed && !ImGui::IsKeyPressed(ImGuiKey_R, false))
+		else if(!sub_needed && !reset_requested && !ImGui::IsKeyPressed(ImGuiKey_R, false))
 			return false;
-		glClearTexImage(trail_texture, 0, GL_RGBA, GL_FLOAT, nullptr);
+		clear_trail();
 	}
+	reset_requested = false;
 	setup_function();
-	glNamedBufferSubData(ssbo, 0, sizeof(agents), agents);
+	setup_lifecycle();
+	// compaction leaves the tails of both buffers stale, these must still be valid agents
+	for(auto ssbo : agent_ssbos)
+		glNamedBufferSubData(ssbo, 0, sizeof(agents), agents);
+	reset_population();
 	return true;
 }
 
 void slime::init() noexcept {
+	twister.seed(std::mt19937::default_seed); // same agents after every init()
 	menu_open = false;
 	num_agents = max_num_agents / 10;
 	decay_rate = 0.1f;
 	diffuse_rate = 3.0f;
 	overlapping = false;
 	num_species = 1;
+	reset_requested = false;
+	lifecycle = true;
+	sparse = true;
+	max_age = 60.0f;
+	starvation_rate = 0.1f;
+	feed_rate = 0.5f;
+	spawn_energy = 0.9f;
+	spawn_density = 4.0f;
+	current = 0;
 	auto [width, height] = framebuffer_size();
 	::width = width;
 	::height = height;
-	::last_time = static_cast<float>(glfwGetTime());
+	::last_time = elapsed_time();
 	(setup_function = setup_uniform)();
-	glGenBuffers(1, &ssbo);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssbo);
-	glNamedBufferData(ssbo, sizeof(agents), agents, GL_DYNAMIC_COPY); // TODO rethink usage
+	setup_lifecycle();
+	glCreateBuffers(2, agent_ssbos);
+	glNamedBufferData(agent_ssbos[0], sizeof(agents), agents, GL_DYNAMIC_COPY); // TODO rethink usage
+	glNamedBufferData(agent_ssbos[1], sizeof(agents), agents, GL_DYNAMIC_COPY);
+	bind_agent_ssbos();
+	glCreateBuffers(1, &population_buffer);
+	glNamedBufferData(population_buffer, sizeof(population), nullptr, GL_DYNAMIC_COPY);
+	reset_population();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, population_buffer);
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, population_buffer);
+	glCreateBuffers(1, &count_ssbo);
+	glCreateBuffers(1, &children_ssbo);
+	glCreateBuffers(1, &offset_ssbo);
+	glCreateBuffers(1, &block_sum_ssbo);
+	glNamedBufferData(count_ssbo, max_num_agents * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+	glNamedBufferData(children_ssbo, sizeof(agents), nullptr, GL_DYNAMIC_COPY);
+	glNamedBufferData(offset_ssbo, max_num_agents * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+	glNamedBufferData(block_sum_ssbo, 1024 * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, count_ssbo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, children_ssbo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, offset_ssbo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, block_sum_ssbo);
 	create_textures();
+	create_tiles();
+	clear_trail();
 	simulation_program = make_program(SLIME_GLSL);
 	postprocess_program = make_program(POSTPROCESS_GLSL);
+	scan_program = make_program(SCAN_GLSL);
+	compact_program = make_program(COMPACT_GLSL);
+	population_program = make_program(POPULATION_GLSL);
+	active_tiles_program = make_program(ACTIVE_TILES_GLSL);
+	slime::stats::init();
 }
 
 void slime::shutdown() noexcept {
-	glDeleteBuffers(1, &ssbo);
+	GLuint buffers[]{agent_ssbos[0], agent_ssbos[1], population_buffer, count_ssbo, children_ssbo, offset_ssbo, block_sum_ssbo, occupancy_ssbo, active_tile_buffer};
+	glDeleteBuffers(9, buffers);
 	glDeleteTextures(2, textures);
 	glDeleteProgram(simulation_program);
 	glDeleteProgram(postprocess_program);
+	glDeleteProgram(scan_program);
+	glDeleteProgram(compact_program);
+	glDeleteProgram(population_program);
+	glDeleteProgram(active_tiles_program);
+	slime::stats::shutdown();
 }
 
 void slime::compute() noexcept {
-	auto time = static_cast<float>(glfwGetTime());
+	auto time = elapsed_time();
 	auto delta_time = prepare() ? 0.0f : time - last_time;
 	last_time = time;
+	auto measured = slime::stats::begin_frame();
 	glUseProgram(simulation_program);
 	glUniform1f(0, time);
 	glUniform1f(1, delta_time);
-	glUniform1ui(2, num_agents);
 	glUniform1ui(3, overlapping);
 	auto mul = static_cast<float>(width);
 	for(GLint location{4}; auto const & s : ::species) {
@@ -215,14 +396,47 @@ void slime::compute() noexcept {
 		glUniform1f(location++, s.sensor_spacing_radians);
 		glUniform1f(location++, s.sensor_distance * mul);
 	}
-	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-	glDispatchCompute(num_agents, 1, 1);
+	glUniform1ui(24, measured);
+	glUniform1ui(25, lifecycle);
+	glUniform1f(26, max_age);
+	glUniform1f(27, starvation_rate);
+	glUniform1f(28, feed_rate);
+	glUniform1f(29, spawn_energy);
+	glUniform1f(30, spawn_density);
+	glUniform1ui(31, sparse);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+	glDispatchComputeIndirect(offsetof(population, simulate_groups));
+	if(lifecycle)
+		compact();
+	if(sparse)
+		list_active_tiles();
 	glUseProgram(postprocess_program);
 	glUniform1f(0, delta_time);
 	glUniform1f(1, decay_rate);
 	glUniform1f(2, diffuse_rate);
 	for(GLint location{3}; auto const & s : ::species)
 		glUniform3fv(location++, 1, s.color);
-	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-	glDispatchCompute(width / 32 + 1, height / 32 + 1, 1);
+	glUniform1ui(9, sparse);
+	if(sparse) {
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, active_tile_buffer);
+		glDispatchComputeIndirect(0);
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, population_buffer);
+	} else {
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		glDispatchCompute(width / 32 + 1, height / 32 + 1, 1);
+	}
+	if(measured)
+		slime::stats::measure(offsetof(population, statistics_groups), width, height);
+}
+
+void slime::configure(config const & config) noexcept {
+	num_agents = config.num_agents < max_num_agents ? config.num_agents : max_num_agents;
+	num_species = config.num_species;
+	decay_rate = config.decay_rate;
+	diffuse_rate = config.diffuse_rate;
+	lifecycle = config.lifecycle;
+	sparse = config.sparse; // reset clears the occupancy along with the trail
+	assign_species();
+	reset_requested = true;
 }
@@ -0,0 +1,136 @@
+#include "slime_statistics.hpp"
+#include <cmath>
+#include <imgui.h>
+#include "managers.hpp"
+#include "shader.hpp"
+#include "shadersrc.hpp"
+
+// matches _statistics_block in trail_stats.glsl, agent_stats.glsl & slime.glsl
+struct gpu_statistics {
+	GLuint histograms[4][32];
+	GLuint covered;
+	GLuint clamped;
+	GLint heading_x, heading_y; // fixed point (1/256)
+	GLuint speed;
+	GLuint agents;
+	GLuint moved_agents; // simulated agents, before deaths & buds
+};
+
+static constexpr unsigned int num_slots{4}; // GPU may be this many frames ahead before measuring pauses
+static constexpr int history_size{256};
+
+static GLuint buffers[num_slots];
+static gpu_statistics const * mapped[num_slots];
+static GLsync fences[num_slots];
+static GLsizei pixels[num_slots];
+static unsigned int next_slot; // oldest slot, written next
+
+static slime::statistics latest;
+static float coverage_history[history_size], clamped_history[history_size], speed_history[history_size];
+static int history_offset;
+
+static GLuint trail_program, agent_program;
+
+static void read(unsigned int slot) noexcept {
+	auto const & s = *mapped[slot];
+	for(int species{}; species < 4; ++species)
+		for(int bin{}; bin < 32; ++bin)
+			latest.histograms[species][bin] = s.covered ? static_cast<float>(s.histograms[species][bin]) / static_cast<float>(s.covered) : 0.0f;
+	latest.coverage = static_cast<float>(s.covered) / static_cast<float>(pixels[slot]);
+	auto x = static_cast<float>(s.heading_x) / 256.0f;
+	auto y = static_cast<float>(s.heading_y) / 256.0f;
+	auto agents = static_cast<float>(s.agents ? s.agents : 1);
+	latest.mean_heading_radians = std::atan2(y, x);
+	latest.heading_coherence = std::hypot(x, y) / agents;
+	// measured displacement, lower than configured for clamped agents
+	latest.mean_speed = static_cast<float>(s.speed) / static_cast<float>(s.moved_agents ? s.moved_agents : 1);
+	latest.clamped_agents = s.clamped;
+	latest.num_agents = s.agents;
+	coverage_history[history_offset] = latest.coverage;
+	clamped_history[history_offset] = static_cast<float>(latest.clamped_agents);
+	speed_history[history_offset] = latest.mean_speed;
+	history_offset = (history_offset + 1) % history_size;
+}
+
+// reads finished slots oldest first, stops at the first one still in flight
+static void poll() noexcept {
+	for(unsigned int i{}; i < num_slots; ++i) {
+		auto slot = (next_slot + i) % num_slots;
+		if(!fences[slot])
+			continue;
+		auto status = glClientWaitSync(fences[slot], 0, 0);
+		if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			return;
+		glDeleteSync(fences[slot]);
+		fences[slot] = nullptr;
+		read(slot);
+	}
+}
+
+void slime::stats::init() noexcept {
+	constexpr GLbitfield flags{GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT};
+	glCreateBuffers(num_slots, buffers);
+	for(unsigned int slot{}; slot < num_slots; ++slot) {
+		glNamedBufferStorage(buffers[slot], sizeof(gpu_statistics), nullptr, flags);
+		mapped[slot] = static_cast<gpu_statistics const *>(glMapNamedBufferRange(buffers[slot], 0, sizeof(gpu_statistics), flags));
+		fences[slot] = nullptr;
+	}
+	next_slot = 0;
+	latest = {};
+	history_offset = 0;
+	trail_program = make_program(TRAIL_STATS_GLSL);
+	agent_program = make_program(AGENT_STATS_GLSL);
+}
+
+void slime::stats::shutdown() noexcept {
+	for(auto & fence : fences)
+		if(fence) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	for(auto buffer : buffers)
+		glUnmapNamedBuffer(buffer);
+	glDeleteBuffers(num_slots, buffers);
+	glDeleteProgram(trail_program);
+	glDeleteProgram(agent_program);
+}
+
+bool slime::stats::begin_frame() noexcept {
+	poll();
+	if(fences[next_slot]) // GPU too far behind, skip rather than wait
+		return false;
+	glClearNamedBufferData(buffers[next_slot], GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, buffers[next_slot]);
+	return true;
+}
+
+void slime::stats::measure(GLintptr indirect, GLsizei width, GLsizei height) noexcept {
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	glUseProgram(trail_program);
+	glDispatchCompute(width / 16 + 1, height / 16 + 1, 1);
+	glUseProgram(agent_program);
+	glDispatchComputeIndirect(indirect);
+	glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+	fences[next_slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	pixels[next_slot] = width * height;
+	next_slot = (next_slot + 1) % num_slots;
+}
+
+void slime::stats::imgui() noexcept {
+	static constinit char label[]{"Species x"};
+	if(!ImGui::CollapsingHeader("Statistics"))
+		return;
+	ImGui::Text("Agents: %u, clamped: %u", latest.num_agents, latest.clamped_agents);
+	ImGui::Text("Heading: %.2f rad, coherence %.3f", latest.mean_heading_radians, latest.heading_coherence);
+	ImGui::PlotLines("Coverage", coverage_history, history_size, history_offset, nullptr, 0.0f, 1.0f, {0.0f, 60.0f});
+	ImGui::PlotLines("Clamped", clamped_history, history_size, history_offset, nullptr, 0.0f, FLT_MAX, {0.0f, 60.0f});
+	ImGui::PlotLines("Mean Speed", speed_history, history_size, history_offset, nullptr, 0.0f, FLT_MAX, {0.0f, 60.0f});
+	for(int species{}; species < 4; ++species) {
+		label[sizeof(label) - 2] = static_cast<char>(species + '1');
+		ImGui::PlotHistogram(label, latest.histograms[species], 32, 0, nullptr, 0.0f, 1.0f, {0.0f, 60.0f});
+	}
+}
+
+slime::statistics const & slime::latest_statistics() noexcept {
+	return latest;
+}
@@ -0,0 +1,16 @@
+#ifndef CS_SLIME_STATISTICS_HPP
+#define CS_SLIME_STATISTICS_HPP
+
+#include <glad/glad.h>
+
+// per-frame statistics of the slime simulation, read back a few frames later
+namespace slime::stats {
+	void init() noexcept;
+	void shutdown() noexcept;
+	[[nodiscard]] bool begin_frame() noexcept; // whether this frame is measured, binds statistics buffer
+	// after simulation & postprocess of a measured frame, indirect: offset of agent dispatch arguments (groups of 256)
+	void measure(GLintptr indirect, GLsizei width, GLsizei height) noexcept;
+	void imgui() noexcept;
+}
+
+#endif // CS_SLIME_STATISTICS_HPP
@@ -0,0 +1,246 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <glad/glad.h>
+#include "../headless/headless.hpp"
+#include "../../src/managers.hpp"
+
+enum class scene { slime, rt };
+
+struct scenario {
+	std::string name;
+	scene kind;
+	size resolution;
+	slime::config slime;
+	rt::config rt;
+};
+
+struct result {
+	std::string name;
+	double ms_per_step;
+	double agents_per_second;
+	double rays_per_second;
+	double bytes_per_second; // estimated from the memory accesses of the shaders
+};
+
+static constexpr size resolutions[]{{1280, 720}, {1920, 1080}, {3840, 2160}};
+static constexpr unsigned int agent_counts[]{100'000, 1'000'000};
+static constexpr unsigned int species_counts[]{1, 4};
+static constexpr float diffuse_rates[]{0.0f, 3.0f};
+static constexpr unsigned int sphere_counts[]{1, 1024, 16384};
+
+static unsigned int steps{100}, warmup_steps{10};
+static double tolerance{0.1};
+
+[[nodiscard]] static std::string resolution_name(size resolution) {
+	return std::to_string(resolution.width) + 'x' + std::to_string(resolution.height);
+}
+
+[[nodiscard]] static std::vector<scenario> make_scenarios(std::string_view filter) {
+	std::vector<scenario> scenarios;
+	auto add = [&](scenario && s) {
+		if(s.name.find(filter) != std::string::npos)
+			scenarios.push_back(std::move(s));
+	};
+	for(auto resolution : resolutions) {
+		// dense postprocess keeps the names of earlier reports
+		for(auto sparse : {false, true}) {
+			std::string postprocess{sparse ? "/sparse" : ""};
+			for(auto agents : agent_counts)
+				for(auto species : species_counts)
+					for(auto diffuse : diffuse_rates) {
+						auto name = "slime/" + resolution_name(resolution)
+							+ "/agents=" + std::to_string(agents)
+							+ "/species=" + std::to_string(species)
+							+ "/diffuse=" + std::to_string(static_cast<int>(diffuse))
+							+ postprocess;
+						add({std::move(name), scene::slime, resolution, {agents, species, 0.1f, diffuse, false, sparse}, {}});
+					}
+			// adds scan & compaction, agent count is only the initial one
+			add({"slime/" + resolution_name(resolution) + "/agents=1000000/lifecycle" + postprocess, scene::slime, resolution, {1'000'000, 4, 0.1f, 3.0f, true, sparse}, {}});
+		}
+		for(auto spheres : sphere_counts) {
+			auto name = "rt/" + resolution_name(resolution) + "/spheres=" + std::to_string(spheres);
+			add({std::move(name), scene::rt, resolution, {}, {spheres, true}});
+		}
+	}
+	return scenarios;
+}
+
+// rough traffic per step, ignores caches
+[[nodiscard]] static double estimate_bytes(scenario const & s) noexcept {
+	constexpr double texel{16.0}; // rgba32f
+	auto pixels = static_cast<double>(s.resolution.width) * s.resolution.height;
+	if(s.kind == scene::slime) {
+		// agent load & store, 3 sensors of 3x3 texels, deposit
+		auto per_agent = 2.0 * 24.0 + 3.0 * 9.0 * texel + texel;
+		if(s.slime.lifecycle) // feeding texel, count, scan, compaction copy
+			per_agent += texel + 4.0 + 2.0 * 4.0 + 2.0 * 24.0;
+		// 3x3 stencil, trail & colored store
+		auto per_texel = 9.0 * texel + 2.0 * texel;
+		return s.slime.num_agents * per_agent + pixels * per_texel;
+	}
+	// visited nodes of a balanced tree (48 bytes) plus the closest sphere & the store
+	auto depth = std::ceil(std::log2(static_cast<double>(s.rt.num_spheres))) + 1.0;
+	auto per_ray = 2.0 * depth * 48.0 + 16.0 + texel;
+	// sphere & velocity load & store, leaf & internal node refit
+	auto per_sphere = 4.0 * 16.0 + 2.0 * 3.0 * 48.0;
+	return pixels * per_ray + s.rt.num_spheres * per_sphere;
+}
+
+static void step(scene kind) noexcept {
+	(void) new_frame();
+	if(kind == scene::slime)
+		slime::compute();
+	else
+		rt::compute();
+	render();
+}
+
+// every scenario starts from the same state, independent of those run before it
+[[nodiscard]] static result run(scenario const & s) {
+	resize(s.resolution);
+	reset_time(); // seeds the shaders
+	if(s.kind == scene::slime) {
+		slime::init();
+		slime::configure(s.slime);
+	} else {
+		rt::init();
+		rt::configure(s.rt);
+	}
+	// first step resets the simulation
+	for(unsigned int i{}; i < warmup_steps; ++i)
+		step(s.kind);
+	glFinish();
+	auto start = std::chrono::steady_clock::now();
+	for(unsigned int i{}; i < steps; ++i)
+		step(s.kind);
+	glFinish();
+	std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+	if(s.kind == scene::slime)
+		slime::shutdown();
+	else
+		rt::shutdown();
+	auto seconds_per_step = duration.count() / steps;
+	auto pixels = static_cast<double>(s.resolution.width) * s.resolution.height;
+	return {
+		s.name,
+		seconds_per_step * 1000.0,
+		s.kind == scene::slime ? s.slime.num_agents / seconds_per_step : 0.0,
+		s.kind == scene::rt ? pixels / seconds_per_step : 0.0,
+		estimate_bytes(s) / seconds_per_step,
+	};
+}
+
+static void write_json(std::ostream & os, std::vector<result> const & results) {
+	os << "{\n\t\"steps\": " << steps << ",\n\t\"results\": [\n";
+	for(bool first{true}; auto const & r : results) {
+		if(!first)
+			os << ",\n";
+		first = false;
+		os << "\t\t{\"name\": \"" << r.name
+			<< "\", \"ms_per_step\": " << r.ms_per_step
+			<< ", \"agents_per_s\": " << r.agents_per_second
+			<< ", \"rays_per_s\": " << r.rays_per_second
+			<< ", \"bytes_per_s\": " << r.bytes_per_second << '}';
+	}
+	os << "\n\t]\n}\n";
+}
+
+// only understands reports written by write_json()
+[[nodiscard]] static bool baseline_ms(std::string const & baseline, std::string const & name, double & ms) noexcept {
+	constexpr std::string_view key{"\"ms_per_step\":"};
+	auto pos = baseline.find("\"name\": \"" + name + '"');
+	if(pos == std::string::npos)
+		return false;
+	pos = baseline.find(key, pos);
+	if(pos == std::string::npos)
+		return false;
+	ms = std::strtod(baseline.c_str() + pos + key.size(), nullptr);
+	return true;
+}
+
+// returns whether no scenario regressed
+[[nodiscard]] static bool compare(std::string const & baseline, std::vector<result> const & results) {
+	bool passed{true};
+	for(auto const & r : results) {
+		double ms;
+		if(!baseline_ms(baseline, r.name, ms)) {
+			std::cerr << "new         " << r.name << ": " << r.ms_per_step << " ms\n";
+			continue;
+		}
+		auto regressed = r.ms_per_step > ms * (1.0 + tolerance);
+		passed = passed && !regressed;
+		std::cerr << (regressed ? "REGRESSION  " : "ok          ") << r.name << ": "
+			<< r.ms_per_step << " ms (baseline " << ms << " ms)\n";
+	}
+	return passed;
+}
+
+[[noreturn]] static void usage() {
+	std::cerr <<
+		"usage: cs_bench [options]\n"
+		"  --steps N         measured steps per scenario (default 100)\n"
+		"  --warmup N        unmeasured steps before measuring (default 10, at least 1)\n"
+		"  --filter TEXT     only run scenarios whose name contains TEXT\n"
+		"  --output FILE     write JSON report to FILE instead of stdout\n"
+		"  --baseline FILE   compare against a previous report, fail on regression\n"
+		"  --tolerance X     allowed slowdown relative to baseline (default 0.1)\n";
+	std::exit(2);
+}
+
+int main(int argc, char ** argv) {
+	std::string_view filter, output, baseline_path;
+	for(int i{1}; i < argc; ++i) {
+		std::string_view arg{argv[i]};
+		if(i + 1 == argc)
+			usage();
+		char const * value = argv[++i];
+		if(arg == "--steps")
+			steps = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+		else if(arg == "--warmup")
+			warmup_steps = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+		else if(arg == "--filter")
+			filter = value;
+		else if(arg == "--output")
+			output = value;
+		else if(arg == "--baseline")
+			baseline_path = value;
+		else if(arg == "--tolerance")
+			tolerance = std::strtod(value, nullptr);
+		else
+			usage();
+	}
+	if(!steps || !warmup_steps)
+		usage();
+	std::string baseline;
+	if(!baseline_path.empty()) {
+		std::ifstream file{std::string{baseline_path}};
+		if(!file) {
+			std::cerr << "cannot read baseline " << baseline_path << '\n';
+			return 2;
+		}
+		baseline.assign(std::istreambuf_iterator<char>{file}, {});
+	}
+	init();
+	std::vector<result> results;
+	for(auto const & s : make_scenarios(filter)) {
+		std::cerr << s.name << '\n';
+		results.push_back(run(s));
+	}
+	shutdown();
+	if(output.empty()) {
+		write_json(std::cout, results);
+	} else {
+		std::ofstream file{std::string{output}};
+		write_json(file, results);
+	}
+	if(!baseline.empty() && !compare(baseline, results))
+		return 1;
+}
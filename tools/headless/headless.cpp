@@ -0,0 +1,132 @@
+#include "headless.hpp"
+#include <exception>
+#include <iostream>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glad/glad.h>
+#include <imgui.h>
+#include "../../src/shader.hpp"
+
+static EGLDisplay display;
+static EGLContext context;
+static EGLSurface surface;
+static constinit size framebuffer{1920, 1080};
+static constinit float frame_time{1.0f / 60.0f};
+static double elapsed;
+
+[[nodiscard]] static EGLDisplay get_display() noexcept {
+	// surfaceless platform doesn't need a window system, e.g. Mesa llvmpipe on a build machine
+	auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	if(get_platform_display) {
+		auto display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		if(display != EGL_NO_DISPLAY)
+			return display;
+	}
+	return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+// prefers configs supporting pbuffers in case surfaceless contexts aren't
+[[nodiscard]] static bool choose_config(EGLConfig & config) noexcept {
+	for(EGLint surface_type : {EGL_PBUFFER_BIT, 0}) {
+		EGLint const attributes[]{
+			EGL_SURFACE_TYPE, surface_type,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_NONE,
+		};
+		EGLint num_configs;
+		if(eglChooseConfig(display, attributes, &config, 1, &num_configs) && num_configs)
+			return true;
+	}
+	return false;
+}
+
+void init() noexcept {
+	display = get_display();
+	if(display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+		terminate("eglInitialize() failed\n");
+	if(!eglBindAPI(EGL_OPENGL_API))
+		terminate("eglBindAPI() failed\n");
+	EGLConfig config;
+	if(!choose_config(config))
+		terminate("eglChooseConfig() failed\n");
+	EGLint const context_attributes[]{
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 5, // e.g. llvmpipe lacks 4.6, shaders only need 4.5
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE,
+	};
+	context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+	if(context == EGL_NO_CONTEXT)
+		terminate("eglCreateContext() failed\n");
+	surface = EGL_NO_SURFACE;
+	if(!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		EGLint const pbuffer_attributes[]{EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+		surface = eglCreatePbufferSurface(display, config, pbuffer_attributes);
+		if(surface == EGL_NO_SURFACE || !eglMakeCurrent(display, surface, surface, context))
+			terminate("eglMakeCurrent() failed\n");
+	}
+	if(!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress)))
+		terminate("gladLoadGLLoader() failed\n");
+	// a shader failing to compile would be timed or rendered as an empty program
+	check_shaders(true);
+	elapsed = 0.0;
+	// managers draw their settings, so a context is needed even though nothing is presented
+	ImGui::CreateContext();
+	auto & io = ImGui::GetIO();
+	io.IniFilename = nullptr;
+	io.Fonts->Build();
+}
+
+void shutdown() noexcept {
+	ImGui::DestroyContext();
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if(surface != EGL_NO_SURFACE)
+		eglDestroySurface(display, surface);
+	eglDestroyContext(display, context);
+	eglTerminate(display);
+	display = EGL_NO_DISPLAY;
+}
+
+void terminate(char const * msg) noexcept {
+	if(display != EGL_NO_DISPLAY)
+		eglTerminate(display);
+	std::cerr << msg;
+	std::terminate();
+}
+
+bool new_frame() noexcept {
+	auto & io = ImGui::GetIO();
+	io.DisplaySize = {static_cast<float>(framebuffer.width), static_cast<float>(framebuffer.height)};
+	io.DeltaTime = frame_time;
+	ImGui::NewFrame();
+	return true;
+}
+
+void render() noexcept {
+	ImGui::Render();
+	elapsed += frame_time;
+}
+
+size framebuffer_size() noexcept {
+	return framebuffer;
+}
+
+float elapsed_time() noexcept {
+	return static_cast<float>(elapsed);
+}
+
+void resize(size framebuffer) noexcept {
+	::framebuffer = framebuffer;
+}
+
+void set_frame_time(float seconds) noexcept {
+	frame_time = seconds;
+}
+
+void advance_time(float seconds) noexcept {
+	elapsed += seconds;
+}
+
+void reset_time() noexcept {
+	elapsed = 0.0;
+}
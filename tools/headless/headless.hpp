@@ -0,0 +1,14 @@
+#ifndef CS_HEADLESS_HPP
+#define CS_HEADLESS_HPP
+
+#include "../../src/app.hpp"
+
+// tools replace src/app.cpp with headless.cpp & src/main.cpp with their own main():
+// cs_bench = tools/bench + tools/headless + src, cs_offline = tools/offline + tools/headless + src
+// only available when linking headless.cpp
+void resize(size framebuffer) noexcept;
+void set_frame_time(float seconds) noexcept; // elapsed_time() advances by this much per render()
+void advance_time(float seconds) noexcept;
+void reset_time() noexcept; // elapsed_time() restarts at 0
+
+#endif // CS_HEADLESS_HPP
@@ -0,0 +1,452 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numbers>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include <glad/glad.h>
+#include "../headless/headless.hpp"
+#include "../../src/managers.hpp"
+#include "../../src/shader.hpp"
+#include "../../src/shadersrc.hpp"
+
+struct agent {
+	float x, y; // pixels
+	float angle_radians;
+	unsigned int species;
+	float age, energy; // unused, lifecycle is off
+};
+
+struct region {
+	int x, y, width, height;
+};
+
+// defaults of slime_manager.cpp, distances relative to picture width
+static constexpr float move_speed{0.15f};
+static constexpr float turn_radians_per_second{std::numbers::pi_v<float> / 3.0f};
+static constexpr float sensor_spacing_radians{std::numbers::pi_v<float> / 6.0f};
+static constexpr float sensor_distance{0.015f};
+static constexpr float decay_rate{0.1f}, diffuse_rate{3.0f};
+static constexpr float color[3]{1.0f, 1.0f, 1.0f};
+static constexpr float frame_time{1.0f / 60.0f};
+
+static std::string_view scene, output;
+static size picture;
+static int tile{2048};
+static unsigned int frames{1}, steps{600}, num_agents{1'000'000}, num_spheres{1024};
+static unsigned long memory_mib; // for trail maps, 0 → half of physical memory
+
+// trail map of the whole picture, kept in host memory or, if too large, in a scratch file
+class trail_store {
+public:
+	trail_store(std::filesystem::path path, bool in_memory) noexcept;
+	trail_store(trail_store const &) = delete;
+	~trail_store();
+	void read(region r, float * texels) noexcept; // tightly packed rgba rows
+	void write(region r, float const * texels) noexcept;
+private:
+	std::filesystem::path _path; // empty if in memory
+	std::fstream _file;
+	std::vector<float> _texels; // rgba rows of the picture if in memory
+};
+
+trail_store::trail_store(std::filesystem::path path, bool in_memory) noexcept {
+	if(in_memory) {
+		_texels.resize(static_cast<std::size_t>(picture.width) * picture.height * 4);
+		return;
+	}
+	_path = std::move(path);
+	std::ofstream{_path, std::ios::binary};
+	std::error_code error;
+	std::filesystem::resize_file(_path, static_cast<std::uintmax_t>(picture.width) * picture.height * 4 * sizeof(float), error);
+	_file.open(_path, std::ios::in | std::ios::out | std::ios::binary);
+	if(error || !_file)
+		terminate("cannot create trail map scratch file\n");
+}
+
+trail_store::~trail_store() {
+	if(_path.empty())
+		return;
+	_file.close();
+	std::error_code error;
+	std::filesystem::remove(_path, error);
+}
+
+void trail_store::read(region r, float * texels) noexcept {
+	if(_path.empty()) {
+		for(int y{}; y < r.height; ++y)
+			std::copy_n(_texels.data() + (static_cast<std::size_t>(r.y + y) * picture.width + r.x) * 4, r.width * 4, texels + static_cast<std::size_t>(y) * r.width * 4);
+		return;
+	}
+	auto row_size = static_cast<std::streamsize>(r.width) * 4 * sizeof(float);
+	for(int y{}; y < r.height; ++y) {
+		_file.seekg((static_cast<std::streamoff>(r.y + y) * picture.width + r.x) * 4 * sizeof(float));
+		_file.read(reinterpret_cast<char *>(texels + static_cast<std::size_t>(y) * r.width * 4), row_size);
+	}
+}
+
+void trail_store::write(region r, float const * texels) noexcept {
+	if(_path.empty()) {
+		for(int y{}; y < r.height; ++y)
+			std::copy_n(texels + static_cast<std::size_t>(y) * r.width * 4, r.width * 4, _texels.data() + (static_cast<std::size_t>(r.y + y) * picture.width + r.x) * 4);
+		return;
+	}
+	auto row_size = static_cast<std::streamsize>(r.width) * 4 * sizeof(float);
+	for(int y{}; y < r.height; ++y) {
+		_file.seekp((static_cast<std::streamoff>(r.y + y) * picture.width + r.x) * 4 * sizeof(float));
+		_file.write(reinterpret_cast<char const *>(texels + static_cast<std::size_t>(y) * r.width * 4), row_size);
+	}
+	if(!_file)
+		terminate("cannot write trail map scratch file\n");
+}
+
+// binary PPM written from top to bottom, one band of rows at a time
+class ppm_writer {
+public:
+	ppm_writer(std::string const & path) noexcept;
+	void write_band(unsigned char const * rows, int num_rows) noexcept; // bottom-up as read from GL
+private:
+	std::ofstream _file;
+};
+
+ppm_writer::ppm_writer(std::string const & path) noexcept : _file{path, std::ios::binary} {
+	_file << "P6\n" << picture.width << ' ' << picture.height << "\n255\n";
+	if(!_file)
+		terminate("cannot create output image\n");
+}
+
+void ppm_writer::write_band(unsigned char const * rows, int num_rows) noexcept {
+	auto row_size = static_cast<std::streamsize>(picture.width) * 3;
+	for(int y{num_rows - 1}; y >= 0; --y)
+		_file.write(reinterpret_cast<char const *>(rows + y * row_size), row_size);
+	if(!_file)
+		terminate("cannot write output image\n");
+}
+
+[[nodiscard]] static std::string frame_path(unsigned int frame) {
+	if(frames == 1)
+		return std::string{output};
+	std::filesystem::path path{output};
+	auto number = std::to_string(frame);
+	number.insert(0, 4 - std::min<std::size_t>(number.size(), 4), '0');
+	auto name = path.stem().string() + '_' + number + path.extension().string();
+	return (path.parent_path() / name).string();
+}
+
+[[nodiscard]] static region clip(region r) noexcept {
+	auto x0 = std::max(r.x, 0), y0 = std::max(r.y, 0);
+	auto x1 = std::min(r.x + r.width, picture.width), y1 = std::min(r.y + r.height, picture.height);
+	return {x0, y0, x1 - x0, y1 - y0};
+}
+
+[[nodiscard]] static region expand(region r, int halo) noexcept {
+	return clip({r.x - halo, r.y - halo, r.width + 2 * halo, r.height + 2 * halo});
+}
+
+[[nodiscard]] static bool contains(region outer, region inner) noexcept {
+	return inner.x >= outer.x && inner.y >= outer.y
+		&& inner.x + inner.width <= outer.x + outer.width && inner.y + inner.height <= outer.y + outer.height;
+}
+
+// both trail maps must fit into the memory budget
+[[nodiscard]] static bool trail_in_memory() noexcept {
+	auto budget = static_cast<double>(memory_mib) * 1024.0 * 1024.0;
+	if(!memory_mib)
+		budget = static_cast<double>(sysconf(_SC_PHYS_PAGES)) * static_cast<double>(sysconf(_SC_PAGE_SIZE)) / 2.0;
+	return 2.0 * picture.width * picture.height * 4 * sizeof(float) <= budget;
+}
+
+// tiles are aligned to the bottom left, row-major
+// calls f(tile) for the tiles of each band from top to bottom, then band_done(height)
+static void for_each_tile(auto && f, auto && band_done) {
+	for(auto y = (picture.height - 1) / tile * tile; y >= 0; y -= tile) {
+		auto height = std::min(tile, picture.height - y);
+		for(int x{}; x < picture.width; x += tile)
+			f(region{x, y, std::min(tile, picture.width - x), height});
+		band_done(height);
+	}
+}
+
+// sensors reach this far beyond the tile of an agent
+[[nodiscard]] static int sensor_halo() noexcept {
+	return static_cast<int>(std::ceil(sensor_distance * static_cast<float>(picture.width))) + 2;
+}
+
+static void render_rt() noexcept {
+	resize({tile, tile});
+	rt::init();
+	rt::configure({num_spheres, frames > 1});
+	set_frame_time(0.0f);
+	std::vector<unsigned char> band(static_cast<std::size_t>(picture.width) * tile * 3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glPixelStorei(GL_PACK_ROW_LENGTH, picture.width);
+	for(unsigned int frame{}; frame < frames; ++frame) {
+		ppm_writer writer{frame_path(frame)};
+		for_each_tile([&](region r) {
+			rt::set_view(r.x, r.y, picture);
+			(void) new_frame();
+			rt::compute();
+			render();
+			glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+			auto offset = static_cast<std::size_t>(r.x) * 3;
+			glGetTextureSubImage(rt::texture(), 0, 0, 0, 0, r.width, r.height, 1, GL_RGB, GL_UNSIGNED_BYTE, static_cast<GLsizei>(band.size() - offset), band.data() + offset);
+		}, [&](int height) {
+			writer.write_band(band.data(), height);
+		});
+		advance_time(frame_time);
+	}
+	glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+	rt::shutdown();
+}
+
+[[nodiscard]] static int tile_of(float x, float y, int tiles_x, int tiles_y) noexcept {
+	auto tx = std::clamp(static_cast<int>(x) / tile, 0, tiles_x - 1);
+	auto ty = std::clamp(static_cast<int>(y) / tile, 0, tiles_y - 1);
+	return ty * tiles_x + tx;
+}
+
+// agents move in tiles sensing a halo of the trail map, afterwards each tile
+// gathers deposits of agents within one texel, diffuses & decays its interior
+static void render_slime() noexcept {
+	auto mul = static_cast<float>(picture.width);
+	auto halo = sensor_halo();
+	auto texture_size = tile + 2 * halo;
+	auto tiles_x = (picture.width + tile - 1) / tile;
+	auto tiles_y = (picture.height + tile - 1) / tile;
+	auto num_tiles = tiles_x * tiles_y;
+	auto simulation_program = make_program(SLIME_GLSL);
+	auto postprocess_program = make_program(POSTPROCESS_GLSL);
+	GLuint textures[2];
+	glCreateTextures(GL_TEXTURE_2D, 2, textures);
+	auto [trail_texture, colored_texture] = textures;
+	glTextureStorage2D(trail_texture, 1, GL_RGBA32F, texture_size, texture_size);
+	glTextureStorage2D(colored_texture, 1, GL_RGBA32F, texture_size, texture_size);
+	glBindImageTexture(0, trail_texture, 0, false, 0, GL_READ_WRITE, GL_RGBA32F);
+	glBindImageTexture(1, colored_texture, 0, false, 0, GL_WRITE_ONLY, GL_RGBA32F);
+	GLuint buffers[4];
+	glCreateBuffers(4, buffers);
+	auto [agent_ssbo, deposit_ssbo, population_buffer, id_ssbo] = buffers;
+	glNamedBufferData(id_ssbo, num_agents * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, id_ssbo);
+	glNamedBufferData(population_buffer, sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, population_buffer);
+	glNamedBufferData(agent_ssbo, num_agents * sizeof(agent), nullptr, GL_DYNAMIC_COPY);
+	std::size_t deposit_capacity{};
+
+	std::mt19937 twister;
+	std::uniform_real_distribution<float>
+		xdist{0.0f, static_cast<float>(picture.width)},
+		ydist{0.0f, static_cast<float>(picture.height)},
+		angledist{0.0f, 2.0f * std::numbers::pi_v<float>};
+	std::vector<agent> agents(num_agents), sorted(num_agents), deposits;
+	for(auto & a : agents)
+		a = {xdist(twister), ydist(twister), angledist(twister), 0, 0.0f, 1.0f};
+	std::vector<unsigned int> begins(num_tiles + 1), deposit_begins(num_tiles + 1), ids(num_agents);
+	std::vector<float> texels(static_cast<std::size_t>(texture_size) * texture_size * 4);
+	std::vector<unsigned char> band(static_cast<std::size_t>(picture.width) * tile * 3);
+	auto scratch = std::filesystem::path{output}.replace_extension();
+	auto in_memory = trail_in_memory();
+	auto front = std::make_unique<trail_store>(scratch.string() + ".trail0", in_memory);
+	auto back = std::make_unique<trail_store>(scratch.string() + ".trail1", in_memory);
+
+	region resident{}; // of front, at texel (0, 0) of trail_texture & unmodified since uploaded
+	// returns the region at texel (0, 0), which contains r
+	auto upload = [&](region r) {
+		if(resident.width && contains(resident, r))
+			return resident;
+		glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+		glClearTexImage(trail_texture, 0, GL_RGBA, GL_FLOAT, nullptr);
+		front->read(r, texels.data());
+		glTextureSubImage2D(trail_texture, 0, 0, 0, r.width, r.height, GL_RGBA, GL_FLOAT, texels.data());
+		return resident = r;
+	};
+	// counting sort of agents by tile, agents within 1 texel of a tile deposit into it
+	// binned_ids receives the index into agents of each binned agent
+	auto bin = [&](auto && tiles_of, std::vector<unsigned int> & begins, std::vector<agent> & binned, std::vector<unsigned int> * binned_ids) {
+		std::fill(begins.begin(), begins.end(), 0);
+		for(auto const & a : agents)
+			tiles_of(a, [&](int t) { ++begins[t + 1]; });
+		for(int t{}; t < num_tiles; ++t)
+			begins[t + 1] += begins[t];
+		binned.resize(begins.back());
+		auto next = begins;
+		for(unsigned int i{}; i < num_agents; ++i)
+			tiles_of(agents[i], [&](int t) {
+				if(binned_ids)
+					(*binned_ids)[next[t]] = i;
+				binned[next[t]++] = agents[i];
+			});
+	};
+	auto current_tile = [&](agent const & a, auto && f) {
+		f(tile_of(a.x, a.y, tiles_x, tiles_y));
+	};
+	auto neighboring_tiles = [&](agent const & a, auto && f) {
+		auto x = static_cast<int>(a.x), y = static_cast<int>(a.y);
+		if(x >= picture.width || y >= picture.height)
+			return; // outside of picture, deposit is dropped like imageStore() would
+		auto tx0 = std::max(x - 1, 0) / tile, tx1 = std::min(x + 1, picture.width - 1) / tile;
+		auto ty0 = std::max(y - 1, 0) / tile, ty1 = std::min(y + 1, picture.height - 1) / tile;
+		for(auto ty = ty0; ty <= ty1; ++ty)
+			for(auto tx = tx0; tx <= tx1; ++tx)
+				f(ty * tiles_x + tx);
+	};
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	for(unsigned int step{}; step < frames * steps; ++step) {
+		auto output_step = (step + 1) % steps == 0;
+		glUseProgram(simulation_program);
+		glUniform1f(0, static_cast<float>(step) * frame_time);
+		glUniform1f(1, frame_time);
+		glUniform1ui(3, false);
+		for(GLint location{4}; location < 20;) {
+			glUniform1f(location++, move_speed * mul);
+			glUniform1f(location++, turn_radians_per_second);
+			glUniform1f(location++, sensor_spacing_radians);
+			glUniform1f(location++, sensor_distance * mul);
+		}
+		glUniform2i(23, picture.width, picture.height);
+
+		// agents keep their order in agents, the ids seed their random numbers independent of tiling
+		bin(current_tile, begins, sorted, &ids);
+		glNamedBufferSubData(agent_ssbo, 0, num_agents * sizeof(agent), sorted.data());
+		glNamedBufferSubData(id_ssbo, 0, num_agents * sizeof(GLuint), ids.data());
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, agent_ssbo);
+		glUniform1ui(21, 1);
+		glUniform1ui(32, true);
+		// reverse order of for_each_tile(), so the deposit phase starts with the last uploaded tile
+		for(int ty{}; ty < tiles_y; ++ty)
+			for(auto tx = tiles_x - 1; tx >= 0; --tx) {
+				auto t = ty * tiles_x + tx;
+				auto count = begins[t + 1] - begins[t];
+				if(!count)
+					continue;
+				auto r = upload(expand({tx * tile, ty * tile, tile, tile}, halo));
+				glNamedBufferSubData(population_buffer, 0, sizeof(count), &count);
+				glUniform1ui(20, begins[t]);
+				glUniform2i(22, r.x, r.y);
+				glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+				glDispatchCompute(count / 64 + 1, 1, 1);
+			}
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		glGetNamedBufferSubData(agent_ssbo, 0, num_agents * sizeof(agent), sorted.data());
+		for(unsigned int i{}; i < num_agents; ++i)
+			agents[ids[i]] = sorted[i];
+
+		bin(neighboring_tiles, deposit_begins, deposits, nullptr);
+		if(deposits.size() > deposit_capacity) {
+			deposit_capacity = deposits.size();
+			glNamedBufferData(deposit_ssbo, deposit_capacity * sizeof(agent), nullptr, GL_DYNAMIC_COPY);
+		}
+		glNamedBufferSubData(deposit_ssbo, 0, deposits.size() * sizeof(agent), deposits.data());
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, deposit_ssbo);
+		std::unique_ptr<ppm_writer> writer;
+		if(output_step)
+			writer = std::make_unique<ppm_writer>(frame_path(step / steps));
+		for_each_tile([&](region interior) {
+			auto t = interior.y / tile * tiles_x + interior.x / tile;
+			auto r = upload(expand(interior, 1));
+			resident = {}; // deposits & postprocess modify the texture
+			if(auto count = deposit_begins[t + 1] - deposit_begins[t]) {
+				glUseProgram(simulation_program);
+				glNamedBufferSubData(population_buffer, 0, sizeof(count), &count);
+				glUniform1ui(20, deposit_begins[t]);
+				glUniform1ui(21, 2);
+				glUniform2i(22, r.x, r.y);
+				glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+				glDispatchCompute(count / 64 + 1, 1, 1);
+			}
+			glUseProgram(postprocess_program);
+			glUniform1f(0, frame_time);
+			glUniform1f(1, decay_rate);
+			glUniform1f(2, diffuse_rate);
+			for(GLint location{3}; location < 7; ++location)
+				glUniform3fv(location, 1, color);
+			glUniform2i(7, interior.x - r.x, interior.y - r.y);
+			glUniform2i(8, interior.width, interior.height);
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+			glDispatchCompute(interior.width / 32 + 1, interior.height / 32 + 1, 1);
+			glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+			glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+			glGetTextureSubImage(trail_texture, 0, interior.x - r.x, interior.y - r.y, 0, interior.width, interior.height, 1, GL_RGBA, GL_FLOAT, static_cast<GLsizei>(texels.size() * sizeof(float)), texels.data());
+			back->write(interior, texels.data());
+			if(!output_step)
+				return;
+			auto offset = static_cast<std::size_t>(interior.x) * 3;
+			glPixelStorei(GL_PACK_ROW_LENGTH, picture.width);
+			glGetTextureSubImage(colored_texture, 0, interior.x - r.x, interior.y - r.y, 0, interior.width, interior.height, 1, GL_RGB, GL_UNSIGNED_BYTE, static_cast<GLsizei>(band.size() - offset), band.data() + offset);
+		}, [&](int height) {
+			if(writer)
+				writer->write_band(band.data(), height);
+		});
+		std::swap(front, back);
+	}
+	glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+	glDeleteBuffers(4, buffers);
+	glDeleteTextures(2, textures);
+	glDeleteProgram(simulation_program);
+	glDeleteProgram(postprocess_program);
+}
+
+[[noreturn]] static void usage() noexcept {
+	std::cerr <<
+		"usage: cs_offline (rt | slime) WIDTH HEIGHT OUTPUT.ppm [options]\n"
+		"  --tile N      tile size in pixels (default 2048)\n"
+		"  --frames N    number of images, numbered OUTPUT_0000.ppm... if more than 1 (default 1)\n"
+		"  --steps N     slime: simulation steps per image (default 600)\n"
+		"  --agents N    slime: number of agents (default 1000000)\n"
+		"  --spheres N   rt: number of spheres, animated if more than 1 frame (default 1024)\n"
+		"  --memory MiB  slime: host memory for the two trail maps, beyond it they are kept in scratch files\n"
+		"                next to OUTPUT (default half of physical memory)\n";
+	std::exit(2);
+}
+
+int main(int argc, char ** argv) {
+	if(argc < 5)
+		usage();
+	scene = argv[1];
+	picture = {std::atoi(argv[2]), std::atoi(argv[3])};
+	output = argv[4];
+	for(int i{5}; i + 1 < argc; i += 2) {
+		std::string_view arg{argv[i]};
+		auto value = std::strtoul(argv[i + 1], nullptr, 10);
+		if(arg == "--tile")
+			tile = static_cast<int>(value);
+		else if(arg == "--frames")
+			frames = static_cast<unsigned int>(value);
+		else if(arg == "--steps")
+			steps = static_cast<unsigned int>(value);
+		else if(arg == "--agents")
+			num_agents = static_cast<unsigned int>(value);
+		else if(arg == "--spheres")
+			num_spheres = static_cast<unsigned int>(value);
+		else if(arg == "--memory")
+			memory_mib = value;
+		else
+			usage();
+	}
+	if((argc - 5) % 2 || picture.width <= 0 || picture.height <= 0 || tile <= 0 || !frames || !steps || !num_agents || !num_spheres)
+		usage();
+	init();
+	GLint max_texture_size;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+	auto halo = scene == "slime" ? sensor_halo() : 0;
+	tile = std::min(tile, static_cast<int>(max_texture_size) - 2 * halo);
+	if(tile <= 0)
+		terminate("sensor halo exceeds GL_MAX_TEXTURE_SIZE\n");
+	if(scene == "rt")
+		render_rt();
+	else if(scene == "slime")
+		render_slime();
+	else
+		usage();
+	shutdown();
+}